@@ -25,3 +25,9 @@
 #import "LGService.h"
 #import "LGCharacteristic.h"
 #import "LGUtils.h"
+#import "LGCodec.h"
+#import "LGCodecPipeline.h"
+#import "LGOperationScheduler.h"
+#import "LGTraceRecorder.h"
+#import "LGTraceReplayer.h"
+#import "LGFleetJob.h"
@@ -23,6 +23,7 @@
 #import "LGBluetooth.h"
 
 @class LGPeripheral;
+@class LGTraceRecorder;
 @class CBCentralManager;
 
 typedef void (^LGCentralManagerDiscoverPeripheralsCallback) (NSArray *peripherals);
@@ -51,6 +52,38 @@ typedef void (^LGCentralManagerDiscoverPeripheralsChangesCallback) (LGPeripheral
  */
 @property (assign, nonatomic) NSUInteger peripheralsCountToStop;
 
+/**
+ * Length of single scan window of duty cycled scan, default is 2 seconds
+ */
+@property (assign, nonatomic) NSTimeInterval scanWindow;
+
+/**
+ * Base pause between scan windows of duty cycled scan, default is 3 seconds.
+ * Pause is multiplied (up to maxScanBackoff times) while connections
+ * are active or transfers are running, and reset when new peripherals appear
+ */
+@property (assign, nonatomic) NSTimeInterval scanIdleInterval;
+
+/**
+ * Max multiplier of scanIdleInterval, default is 8
+ */
+@property (assign, nonatomic) NSUInteger maxScanBackoff;
+
+/**
+ * Current pause between scan windows (scanIdleInterval with backoff applied)
+ */
+@property (assign, nonatomic, readonly) NSTimeInterval currentScanIdleInterval;
+
+/**
+ * Indicates if duty cycled scan is in progress
+ */
+@property (assign, nonatomic, readonly, getter = isDutyCycling) BOOL dutyCycling;
+
+/**
+ * Part of time (0..1) the radio was scanning since latest duty cycled scan was started
+ */
+@property (assign, nonatomic, readonly) double scanOccupancy;
+
 /**
  * Human readable property that indicates why central manager is not ready. KVO observable.
  */
@@ -66,6 +99,12 @@ typedef void (^LGCentralManagerDiscoverPeripheralsChangesCallback) (LGPeripheral
  */
 @property (strong, nonatomic, readonly) CBCentralManager *manager;
 
+/**
+ * When set, all CBCentralManager and CBPeripheral delegate events
+ * are recorded into recorder's trace (see LGTraceReplayer for replaying)
+ */
+@property (strong, atomic) LGTraceRecorder *traceRecorder;
+
 /**
  * KVO for centralReady and centralNotReadyReason
  */
@@ -141,6 +180,26 @@ typedef void (^LGCentralManagerDiscoverPeripheralsChangesCallback) (LGPeripheral
                              options:(NSDictionary *)options
                           completion:(LGCentralManagerDiscoverPeripheralsCallback)aCallback;
 
+/**
+ * Scans for nearby peripherals by scanWindow long windows separated by
+ * currentScanIdleInterval pauses, so connections get more airtime.
+ * Fills the - NSArray *peripherals, runs until stopScanForPeripherals
+ * @param aChangesCallback block which will be called on each peripheral update
+ */
+- (void)scanForPeripheralsByDutyCycleWithChanges:(LGCentralManagerDiscoverPeripheralsChangesCallback)aChangesCallback;
+
+/**
+ * Scans for nearby peripherals with criterias by scanWindow long windows
+ * separated by currentScanIdleInterval pauses.
+ * Fills the - NSArray *peripherals, runs until stopScanForPeripherals
+ * @param serviceUUIDs An array of CBUUID objects that the app is interested in.
+ * @param options An optional dictionary specifying options to customize the scan.
+ * @param aChangesCallback block which will be called on each peripheral update
+ */
+- (void)scanForPeripheralsByDutyCycleWithServices:(NSArray *)serviceUUIDs
+                                          options:(NSDictionary *)options
+                                          changes:(LGCentralManagerDiscoverPeripheralsChangesCallback)aChangesCallback;
+
 /**
  * Stops ongoing scan proccess
  */
@@ -169,4 +228,22 @@ typedef void (^LGCentralManagerDiscoverPeripheralsChangesCallback) (LGPeripheral
  */
 + (LGCentralManager *)sharedInstance;
 
+#pragma mark - Private Handlers -
+
+// ----- Used for input events (live and replayed) -----/
+
+- (void)handleConnectedPeripheral:(LGPeripheral *)aPeripheral error:(NSError *)anError;
+
+- (void)handleDisconnectedPeripheral:(LGPeripheral *)aPeripheral error:(NSError *)anError;
+
+- (void)handleDiscoveredPeripheral:(LGPeripheral *)aPeripheral
+                 advertisementData:(NSDictionary *)advertisementData
+                              RSSI:(NSNumber *)RSSI;
+
+/**
+ * @return Known wrapper without CBPeripheral with anIdentifier, or new one (used for replay).
+ * Live peripherals with the same identifier are never returned
+ */
+- (LGPeripheral *)wrapperByIdentifier:(NSUUID *)anIdentifier;
+
 @end
@@ -28,6 +28,7 @@
 #import <IOBluetooth/IOBluetooth.h>
 #endif
 #import "LGPeripheral.h"
+#import "LGTraceRecorder.h"
 #import "LGUtils.h"
 
 @interface LGCentralManager() <CBCentralManagerDelegate>
@@ -62,6 +63,44 @@
  */
 @property(nonatomic) CBCentralManagerState cbCentralManagerState;
 
+/**
+ * Currently connected peripherals, used for backing off duty cycled scan
+ */
+@property (strong, nonatomic) NSMutableSet *connectedPeripherals;
+
+/**
+ * Scan criterias of duty cycled scan
+ */
+@property (strong, nonatomic) NSArray *dutyCycleServices;
+
+@property (strong, nonatomic) NSDictionary *dutyCycleOptions;
+
+/**
+ * Multiplier of scanIdleInterval
+ */
+@property (assign, nonatomic) NSUInteger scanBackoff;
+
+/**
+ * Peripherals which advertised since scan was started, used for counting new peripherals
+ */
+@property (strong, nonatomic) NSMutableSet *advertisedPeripherals;
+
+/**
+ * Count of new peripherals discovered during current scan window
+ */
+@property (assign, nonatomic) NSUInteger windowDiscoveriesCount;
+
+/**
+ * Occupancy accounting of duty cycled scan
+ */
+@property (assign, nonatomic) CFAbsoluteTime dutyCycleStartTime;
+
+@property (assign, nonatomic) CFAbsoluteTime dutyCycleStopTime;
+
+@property (assign, nonatomic) CFAbsoluteTime windowStartTime;
+
+@property (assign, nonatomic) NSTimeInterval scanTime;
+
 @end
 
 @implementation LGCentralManager
@@ -90,6 +129,25 @@
     return sortedArray;
 }
 
+- (NSTimeInterval)currentScanIdleInterval
+{
+    return self.scanIdleInterval * self.scanBackoff;
+}
+
+- (double)scanOccupancy
+{
+    if (!self.dutyCycleStartTime) {
+        return 0;
+    }
+    CFAbsoluteTime now = self.isDutyCycling ? CFAbsoluteTimeGetCurrent() : self.dutyCycleStopTime;
+    NSTimeInterval scanTime = self.scanTime;
+    if (self.isDutyCycling && self.isScanning) {
+        scanTime += now - self.windowStartTime;
+    }
+    NSTimeInterval totalTime = now - self.dutyCycleStartTime;
+    return totalTime > 0 ? MIN(scanTime / totalTime, 1.0) : 1.0;
+}
+
 /*----------------------------------------------------*/
 #pragma mark - KVO -
 /*----------------------------------------------------*/
@@ -120,8 +178,38 @@
                                  options:@{CBCentralManagerScanOptionAllowDuplicatesKey : @YES}];
 }
 
+- (void)scanForPeripheralsByDutyCycleWithChanges:(LGCentralManagerDiscoverPeripheralsChangesCallback)aChangesCallback
+{
+    [self scanForPeripheralsByDutyCycleWithServices:nil
+                                            options:@{CBCentralManagerScanOptionAllowDuplicatesKey : @YES}
+                                            changes:aChangesCallback];
+}
+
+- (void)scanForPeripheralsByDutyCycleWithServices:(NSArray *)serviceUUIDs
+                                          options:(NSDictionary *)options
+                                          changes:(LGCentralManagerDiscoverPeripheralsChangesCallback)aChangesCallback
+{
+    [self cancelDutyCycle];
+    // Pending stop of interval scan would end duty cycle
+    [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                             selector:@selector(stopScanForPeripherals)
+                                               object:nil];
+    self.scanBlock = nil;
+    self.changesBlock = aChangesCallback;
+    self.dutyCycleServices = serviceUUIDs;
+    self.dutyCycleOptions = options;
+    self.scanBackoff = 1;
+    self.scanTime = 0;
+    self.dutyCycleStartTime = CFAbsoluteTimeGetCurrent();
+    _dutyCycling = YES;
+    [self.scannedPeripherals removeAllObjects];
+    [self.advertisedPeripherals removeAllObjects];
+    [self scanWindowStarted];
+}
+
 - (void)stopScanForPeripherals
 {
+    [self cancelDutyCycle];
     self.scanning = NO;
 	[self.manager stopScan];
     
@@ -138,7 +226,9 @@
 - (void)scanForPeripheralsWithServices:(NSArray *)serviceUUIDs
                                options:(NSDictionary *)options
 {
+    [self cancelDutyCycle];
     [self.scannedPeripherals removeAllObjects];
+    [self.advertisedPeripherals removeAllObjects];
     self.scanning = YES;
 	[self.manager scanForPeripheralsWithServices:serviceUUIDs
                                          options:options];
@@ -192,6 +282,74 @@
 #pragma mark - Private Methods -
 /*----------------------------------------------------*/
 
+- (void)scanWindowStarted
+{
+    self.windowDiscoveriesCount = 0;
+    self.windowStartTime = CFAbsoluteTimeGetCurrent();
+    self.scanning = YES;
+    [self.manager scanForPeripheralsWithServices:self.dutyCycleServices
+                                         options:self.dutyCycleOptions];
+    [self performSelector:@selector(scanWindowEnded)
+               withObject:nil
+               afterDelay:self.scanWindow];
+}
+
+- (void)scanWindowEnded
+{
+    self.scanning = NO;
+    [self.manager stopScan];
+    self.scanTime += CFAbsoluteTimeGetCurrent() - self.windowStartTime;
+    
+    if (self.windowDiscoveriesCount) {
+        // New devices around, ramping up
+        self.scanBackoff = 1;
+    } else if ([self hasRunningTransfers]) {
+        // Data is moving, giving it as much airtime as possible
+        self.scanBackoff = MAX(self.maxScanBackoff, 1);
+    } else if ([self.connectedPeripherals count]) {
+        self.scanBackoff = MIN(self.scanBackoff * 2, MAX(self.maxScanBackoff, 1));
+    } else {
+        self.scanBackoff = MAX(self.scanBackoff / 2, 1);
+    }
+    LGLog(@"Scan window ended, %lu new peripherals, next window in %.1f sec, occupancy %.2f",
+          (unsigned long)self.windowDiscoveriesCount, self.currentScanIdleInterval, self.scanOccupancy);
+    
+    [self performSelector:@selector(scanWindowStarted)
+               withObject:nil
+               afterDelay:self.currentScanIdleInterval];
+}
+
+- (void)cancelDutyCycle
+{
+    if (!self.isDutyCycling) {
+        return;
+    }
+    if (self.isScanning) {
+        self.scanTime += CFAbsoluteTimeGetCurrent() - self.windowStartTime;
+    }
+    self.dutyCycleStopTime = CFAbsoluteTimeGetCurrent();
+    _dutyCycling = NO;
+    [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                             selector:@selector(scanWindowStarted)
+                                               object:nil];
+    [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                             selector:@selector(scanWindowEnded)
+                                               object:nil];
+}
+
+/**
+ * @return YES if any connected peripheral has running or queued operations
+ */
+- (BOOL)hasRunningTransfers
+{
+    for (LGPeripheral *peripheral in self.connectedPeripherals) {
+        if (peripheral.scheduler.queueDepth || peripheral.scheduler.inFlightCount) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
 - (NSString *)stateMessage
 {
 	NSString *message = nil;
@@ -238,6 +396,22 @@
     return wrapper;
 }
 
+- (LGPeripheral *)wrapperByIdentifier:(NSUUID *)anIdentifier
+{
+    NSString *UUIDString = [anIdentifier UUIDString];
+    for (LGPeripheral *scanned in self.scannedPeripherals) {
+        // Live peripherals are never returned, so replay can't touch their state
+        if (!scanned.cbPeripheral && [scanned.UUIDString isEqualToString:UUIDString]) {
+            return scanned;
+        }
+    }
+    LGPeripheral *wrapper = [[LGPeripheral alloc] initWithIdentifier:anIdentifier manager:self];
+    if (wrapper) {
+        [self.scannedPeripherals addObject:wrapper];
+    }
+    return wrapper;
+}
+
 - (NSArray *)wrappersByPeripherals:(NSArray *)peripherals
 {
     NSMutableArray *lgPeripherals = [NSMutableArray new];
@@ -254,31 +428,57 @@
 
 - (void)centralManager:(CBCentralManager *)central didConnectPeripheral:(CBPeripheral *)peripheral
 {
+    [self.traceRecorder recordEventOfType:LGTraceEventTypeConnect
+                               peripheral:peripheral.identifier
+                                  service:nil
+                           characteristic:nil
+                                    value:0
+                                  payload:nil
+                                    error:nil];
     dispatch_async(dispatch_get_main_queue(), ^{
-        [[self wrapperByPeripheral:peripheral] handleConnectionWithError:nil];
+        [self handleConnectedPeripheral:[self wrapperByPeripheral:peripheral] error:nil];
     });
 }
 
 - (void)centralManager:(CBCentralManager *)central didFailToConnectPeripheral:(CBPeripheral *)peripheral
                  error:(NSError *)error
 {
+    [self.traceRecorder recordEventOfType:LGTraceEventTypeFailToConnect
+                               peripheral:peripheral.identifier
+                                  service:nil
+                           characteristic:nil
+                                    value:0
+                                  payload:nil
+                                    error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
-        [[self wrapperByPeripheral:peripheral] handleConnectionWithError:error];
+        [self handleConnectedPeripheral:[self wrapperByPeripheral:peripheral] error:error];
     });
 }
 
 - (void)centralManager:(CBCentralManager *)central didDisconnectPeripheral:(CBPeripheral *)peripheral
                  error:(NSError *)error
 {
+    [self.traceRecorder recordEventOfType:LGTraceEventTypeDisconnect
+                               peripheral:peripheral.identifier
+                                  service:nil
+                           characteristic:nil
+                                    value:0
+                                  payload:nil
+                                    error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
-        LGPeripheral *lgPeripheral = [self wrapperByPeripheral:peripheral];
-        [lgPeripheral handleDisconnectWithError:error];
-        [self.scannedPeripherals removeObject:lgPeripheral];
+        [self handleDisconnectedPeripheral:[self wrapperByPeripheral:peripheral] error:error];
     });
 }
 
 - (void)centralManagerDidUpdateState:(CBCentralManager *)central
 {
+    [self.traceRecorder recordEventOfType:LGTraceEventTypeUpdateState
+                               peripheral:nil
+                                  service:nil
+                           characteristic:nil
+                                    value:central.state
+                                  payload:nil
+                                    error:nil];
     self.cbCentralManagerState = (CBCentralManagerState)central.state;
     NSString *message = [self stateMessage];
     if (message) {
@@ -293,29 +493,68 @@
      advertisementData:(NSDictionary *)advertisementData
                   RSSI:(NSNumber *)RSSI
 {
+    [self.traceRecorder recordDiscoveryOfPeripheral:peripheral.identifier
+                                  advertisementData:advertisementData
+                                               RSSI:RSSI];
     dispatch_async(dispatch_get_main_queue(), ^{
-        LGPeripheral *lgPeripheral = [self wrapperByPeripheral:peripheral];
-        if (!lgPeripheral.RSSI) {
-            lgPeripheral.RSSI = [RSSI integerValue];
-        } else {
-            // Calculating AVG RSSI
-            lgPeripheral.RSSI = (lgPeripheral.RSSI + [RSSI integerValue]) / 2;
-        }
-        lgPeripheral.advertisingData = advertisementData;
-        
-        if (self.changesBlock != nil) {
-            self.changesBlock(lgPeripheral);
-        }
-        
-        if ([self.scannedPeripherals count] >= self.peripheralsCountToStop) {
-            [NSObject cancelPreviousPerformRequestsWithTarget:self
-                                                     selector:@selector(stopScanForPeripherals)
-                                                       object:nil];
-            [self stopScanForPeripherals];
-        }
+        [self handleDiscoveredPeripheral:[self wrapperByPeripheral:peripheral]
+                       advertisementData:advertisementData
+                                    RSSI:RSSI];
     });
 }
 
+/*----------------------------------------------------*/
+#pragma mark - Handler Methods -
+/*----------------------------------------------------*/
+
+- (void)handleConnectedPeripheral:(LGPeripheral *)aPeripheral error:(NSError *)anError
+{
+    if (!anError && aPeripheral) {
+        [self.connectedPeripherals addObject:aPeripheral];
+    }
+    [aPeripheral handleConnectionWithError:anError];
+}
+
+- (void)handleDisconnectedPeripheral:(LGPeripheral *)aPeripheral error:(NSError *)anError
+{
+    if (!aPeripheral) {
+        return;
+    }
+    [self.connectedPeripherals removeObject:aPeripheral];
+    [aPeripheral handleDisconnectWithError:anError];
+    [self.scannedPeripherals removeObject:aPeripheral];
+    [self.advertisedPeripherals removeObject:aPeripheral];
+}
+
+- (void)handleDiscoveredPeripheral:(LGPeripheral *)aPeripheral
+                 advertisementData:(NSDictionary *)advertisementData
+                              RSSI:(NSNumber *)RSSI
+{
+    if (aPeripheral && ![self.advertisedPeripherals containsObject:aPeripheral]) {
+        // First advertisement of this peripheral since scan was started
+        [self.advertisedPeripherals addObject:aPeripheral];
+        self.windowDiscoveriesCount++;
+    }
+    if (!aPeripheral.RSSI) {
+        aPeripheral.RSSI = [RSSI integerValue];
+    } else {
+        // Calculating AVG RSSI
+        aPeripheral.RSSI = (aPeripheral.RSSI + [RSSI integerValue]) / 2;
+    }
+    aPeripheral.advertisingData = advertisementData;
+    
+    if (self.changesBlock != nil) {
+        self.changesBlock(aPeripheral);
+    }
+    
+    if ([self.scannedPeripherals count] >= self.peripheralsCountToStop) {
+        [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                                 selector:@selector(stopScanForPeripherals)
+                                                   object:nil];
+        [self stopScanForPeripherals];
+    }
+}
+
 /*----------------------------------------------------*/
 #pragma mark - LifeCycle -
 /*----------------------------------------------------*/
@@ -342,6 +581,12 @@ static LGCentralManager *sharedInstance = nil;
         _cbCentralManagerState = (CBCentralManagerState)_manager.state;
         _scannedPeripherals = [NSMutableArray new];
         _peripheralsCountToStop = NSUIntegerMax;
+        _connectedPeripherals = [NSMutableSet new];
+        _advertisedPeripherals = [NSMutableSet new];
+        _scanWindow = 2;
+        _scanIdleInterval = 3;
+        _maxScanBackoff = 8;
+        _scanBackoff = 1;
 	}
 	return self;
 }
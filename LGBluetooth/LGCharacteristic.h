@@ -20,7 +20,10 @@
 // IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#import "LGOperationScheduler.h"
+
 @class CBCharacteristic;
+@class LGCodecPipeline;
 
 @interface LGCharacteristic : NSObject
 
@@ -38,6 +41,18 @@ typedef void (^LGCharacteristicWriteCallback) (NSError *error);
  */
 @property (weak, nonatomic, readonly) NSString *UUIDString;
 
+/**
+ * Codec pipeline applied to written/read/notified values of this characteristic.
+ * Filled from LGPeripheral's setCodecPipeline:forCharacteristicUUID: on discovery
+ */
+@property (strong, nonatomic) LGCodecPipeline *codecPipeline;
+
+/**
+ * Priority class of operations made on this characteristic, default is LGOperationPriorityDefault.
+ * Filled from LGPeripheral's setOperationPriority:forCharacteristicUUID: on discovery
+ */
+@property (assign, nonatomic) LGOperationPriority operationPriority;
+
 /**
  * Enables or disables notifications/indications for the characteristic 
  * value of characteristic.
@@ -28,6 +28,8 @@
 #elif TARGET_OS_MAC
 #import <IOBluetooth/IOBluetooth.h>
 #endif
+#import "LGCodecPipeline.h"
+#import "LGPeripheral.h"
 #import "LGUtils.h"
 
 @interface LGCharacteristic ()
@@ -99,8 +101,12 @@
     
     [self push:aCallback toArray:self.notifyOperationStack];
     
-    [self.cbCharacteristic.service.peripheral setNotifyValue:notifyValue
-                                           forCharacteristic:self.cbCharacteristic];
+    [self scheduleOperationWithType:LGOperationTypeNotify expectsResponse:YES block:^{
+        [self.cbCharacteristic.service.peripheral setNotifyValue:notifyValue
+                                               forCharacteristic:self.cbCharacteristic];
+    } failure:^(NSError *error) {
+        [self handleSetNotifiedWithError:error];
+    }];
 }
 
 - (void)writeValue:(NSData *)data
@@ -109,12 +115,33 @@
     CBCharacteristicWriteType type =  aCallback ?
     CBCharacteristicWriteWithResponse : CBCharacteristicWriteWithoutResponse;
     
+    LGCodecPipeline *pipeline = self.codecPipeline;
+    if (aCallback && pipeline) {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSUInteger rawLength = [data length];
+        LGCharacteristicWriteCallback callback = aCallback;
+        aCallback = ^(NSError *error) {
+            if (!error) {
+                [pipeline recordTransferOfRawBytes:rawLength
+                                          duration:CFAbsoluteTimeGetCurrent() - start];
+            } else {
+                // Peer didn't get the value, next one is sent without reference (keyframe)
+                [pipeline reset];
+            }
+            callback(error);
+        };
+    }
     if (aCallback) {
         [self push:aCallback toArray:self.writeOperationStack];
     }
-    [self.cbCharacteristic.service.peripheral writeValue:data
-                                       forCharacteristic:self.cbCharacteristic
-                                                    type:type];
+    
+    if (pipeline) {
+        [pipeline encodeData:data completion:^(NSData *encoded) {
+            [self enqueueWriteValue:encoded type:type];
+        }];
+    } else {
+        [self enqueueWriteValue:data type:type];
+    }
 }
 
 - (void)writeByte:(int8_t)aByte
@@ -129,14 +156,97 @@
     if (!aCallback) {
         return;
     }
+    LGCodecPipeline *pipeline = self.codecPipeline;
+    if (pipeline) {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        LGCharacteristicReadCallback callback = aCallback;
+        aCallback = ^(NSData *data, NSError *error) {
+            if (!error) {
+                [pipeline recordTransferOfRawBytes:[data length]
+                                          duration:CFAbsoluteTimeGetCurrent() - start];
+            }
+            callback(data, error);
+        };
+    }
     [self push:aCallback toArray:self.readOperationStack];
-    [self.cbCharacteristic.service.peripheral readValueForCharacteristic:self.cbCharacteristic];
+    [self scheduleOperationWithType:LGOperationTypeRead expectsResponse:YES block:^{
+        [self.cbCharacteristic.service.peripheral readValueForCharacteristic:self.cbCharacteristic];
+    } failure:^(NSError *error) {
+        LGCharacteristicReadCallback callback = [self popFromArray:self.readOperationStack];
+        if (callback) {
+            callback(nil, error);
+        }
+    }];
 }
 
 /*----------------------------------------------------*/
 #pragma mark - Private Methods -
 /*----------------------------------------------------*/
 
+/**
+ * Enqueues operation in the order it was issued. Writes of characteristic with
+ * codec pipeline are enqueued only after encoding, so other operations
+ * wait for pending coding too (e.g. read right after write returns the written value)
+ */
+- (void)scheduleOperationWithType:(LGOperationType)aType
+                  expectsResponse:(BOOL)expectsResponse
+                            block:(dispatch_block_t)aBlock
+                          failure:(LGOperationSchedulerFailureCallback)aFailureCallback
+{
+    LGCodecPipeline *pipeline = self.codecPipeline;
+    if (pipeline) {
+        [pipeline performAfterPendingCoding:^{
+            [self enqueueOperationWithType:aType
+                           expectsResponse:expectsResponse
+                                     block:aBlock
+                                   failure:aFailureCallback];
+        }];
+    } else {
+        [self enqueueOperationWithType:aType
+                       expectsResponse:expectsResponse
+                                 block:aBlock
+                               failure:aFailureCallback];
+    }
+}
+
+/**
+ * Passes operation to owning peripheral's scheduler,
+ * or sends it immediately if peripheral isn't wrapped by LGPeripheral
+ * @param aFailureCallback called if scheduler drops operation (not connected, timeout, disconnect)
+ */
+- (void)enqueueOperationWithType:(LGOperationType)aType
+                 expectsResponse:(BOOL)expectsResponse
+                           block:(dispatch_block_t)aBlock
+                         failure:(LGOperationSchedulerFailureCallback)aFailureCallback
+{
+    id delegate = self.cbCharacteristic.service.peripheral.delegate;
+    if ([delegate isKindOfClass:[LGPeripheral class]]) {
+        [[(LGPeripheral *)delegate scheduler] enqueueOperationWithPriority:self.operationPriority
+                                                                      type:aType
+                                                                       key:self.cbCharacteristic
+                                                           expectsResponse:expectsResponse
+                                                                     block:aBlock
+                                                                   failure:aFailureCallback];
+    } else {
+        aBlock();
+    }
+}
+
+- (void)enqueueWriteValue:(NSData *)aData type:(CBCharacteristicWriteType)aType
+{
+    BOOL expectsResponse = (aType == CBCharacteristicWriteWithResponse);
+    [self enqueueOperationWithType:LGOperationTypeWrite
+                   expectsResponse:expectsResponse
+                             block:^{
+                                 [self.cbCharacteristic.service.peripheral writeValue:aData
+                                                                    forCharacteristic:self.cbCharacteristic
+                                                                                 type:aType];
+                             }
+                           failure:expectsResponse ? ^(NSError *error) {
+                               [self handleWrittenValueWithError:error];
+                           } : nil];
+}
+
 - (void)push:(id)anObject toArray:(NSMutableArray *)aArray
 {
     [aArray addObject:anObject];
@@ -152,6 +262,18 @@
     return aObject;
 }
 
+- (void)deliverReadValue:(NSData *)aValue error:(NSError *)anError
+{
+    if (self.updateCallback) {
+        self.updateCallback(aValue, anError);
+    }
+    
+    LGCharacteristicReadCallback callback = [self popFromArray:self.readOperationStack];
+    if (callback) {
+        callback(aValue, anError);
+    }
+}
+
 /*----------------------------------------------------*/
 #pragma mark - Handler Methods -
 /*----------------------------------------------------*/
@@ -170,13 +292,13 @@
     LGLog(@"Characteristic - %@ value - %s error - %@",
           self.cbCharacteristic.UUID, [aValue bytes], anError);
     
-    if (self.updateCallback) {
-        self.updateCallback(aValue, anError);
-    }
-    
-    LGCharacteristicReadCallback callback = [self popFromArray:self.readOperationStack];
-    if (callback) {
-        callback(aValue, anError);
+    if (self.codecPipeline) {
+        // Decoding is serial, so values are delivered in the order they came
+        [self.codecPipeline decodeData:aValue completion:^(NSData *data, NSError *error) {
+            [self deliverReadValue:data error:anError ? : error];
+        }];
+    } else {
+        [self deliverReadValue:aValue error:anError];
     }
 }
 
@@ -200,6 +322,7 @@
     }
     if (self = [super init]) {
         _cbCharacteristic = aCharacteristic;
+        _operationPriority = LGOperationPriorityDefault;
     }
     return self;
 }
@@ -0,0 +1,106 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma mark - Error Domains -
+
+/**
+ * Error domain for payload decoding errors
+ */
+extern NSString * const kLGCodecErrorDomain;
+
+#pragma mark - Error Codes -
+
+/**
+ * Received payload can't be decoded by codec
+ */
+extern const NSInteger kLGCodecMalformedDataErrorCode;
+
+#pragma mark - Error Messages -
+
+/**
+ * Error message for payloads that can't be decoded
+ */
+extern NSString * const kLGCodecMalformedDataErrorMessage;
+
+#pragma mark - Codec protocol -
+
+/**
+ * Single stage of payload transformation.
+ * Codecs are always invoked on LGCodecPipeline's serial queue,
+ * so stateful codecs don't need extra synchronization
+ */
+@protocol LGCodec <NSObject>
+
+/**
+ * Transforms outgoing payload
+ * @param aData raw bytes which needs to be sent
+ * @return Encoded bytes
+ */
+- (NSData *)encodeData:(NSData *)aData;
+
+/**
+ * Restores incoming payload
+ * @param aData encoded bytes which were received
+ * @param anError will be filled if aData can't be decoded
+ * @return Decoded bytes, nil on failure
+ */
+- (NSData *)decodeData:(NSData *)aData error:(NSError **)anError;
+
+@optional
+
+/**
+ * Forgets outgoing state, so the next encoded payload can be decoded without
+ * earlier ones (e.g. keyframe). Called when the peer may have missed a payload
+ * (disconnect, failed write), decoding state is kept as the peer didn't reset
+ */
+- (void)reset;
+
+@end
+
+#pragma mark - Built-in codecs -
+
+/**
+ * Lightweight LZ77 family compressor (LZ4-like block format).
+ * Payloads that don't shrink are stored as is, so the encoded
+ * value is never larger than input + 1 byte of header
+ */
+@interface LGLZCodec : NSObject <LGCodec>
+
+@end
+
+/**
+ * Delta encoding against the last value which was passed through codec.
+ * Every byte is XOR-ed with the byte at the same position of the previous value,
+ * so unchanged regions become zeros (nicely compressable by LGLZCodec).
+ * Every payload starts with frame byte : keyframes carry value as is,
+ * so the receiver resynchronises after reset of the sender.
+ * NOTE : Receiver must see every delta frame, use it only with
+ * write-with-response / read operations
+ */
+@interface LGDeltaCodec : NSObject <LGCodec>
+
+/**
+ * Forgets last encoded value, next payload will be sent as keyframe
+ */
+- (void)reset;
+
+@end
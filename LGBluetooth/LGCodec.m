@@ -0,0 +1,325 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGCodec.h"
+
+#import "LGUtils.h"
+
+// Error Domains
+NSString * const kLGCodecErrorDomain = @"LGCodecErrorDomain";
+
+// Error Codes
+const NSInteger kLGCodecMalformedDataErrorCode = 420;
+
+NSString * const kLGCodecMalformedDataErrorMessage = @"Received payload can't be decoded";
+
+/*----------------------------------------------------*/
+#pragma mark - LZ block format -
+/*----------------------------------------------------*/
+
+// Every encoded payload starts with method byte,
+// LZ payloads are followed by 4 byte (little endian) raw length
+#define kLGLZMethodStored   0
+#define kLGLZMethodLZ       1
+#define kLGLZHeaderLength   5
+
+#define kLGLZMinMatch       4
+#define kLGLZHashBits       12
+#define kLGLZMaxOffset      0xFFFF
+
+static inline uint32_t LGLZHash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - kLGLZHashBits);
+}
+
+static inline uint8_t *LGLZWriteLength(uint8_t *op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+/**
+ * Writes single sequence : token, literals, offset and match length extension.
+ * Sequence with zero matchLength terminates block
+ */
+static uint8_t *LGLZWriteSequence(uint8_t *op, const uint8_t *literals, size_t literalLength,
+                                  size_t offset, size_t matchLength)
+{
+    uint8_t *token = op++;
+    size_t matchCode = matchLength ? matchLength - kLGLZMinMatch : 0;
+    *token = (uint8_t)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    if (literalLength >= 15) {
+        op = LGLZWriteLength(op, literalLength - 15);
+    }
+    memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (matchLength) {
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+        if (matchCode >= 15) {
+            op = LGLZWriteLength(op, matchCode - 15);
+        }
+    }
+    return op;
+}
+
+static size_t LGLZCompressBound(size_t length)
+{
+    return length + length / 255 + 16;
+}
+
+static size_t LGLZCompress(const uint8_t *src, size_t srcLength, uint8_t *dst)
+{
+    // Positions are stored +1, zero means empty slot
+    uint32_t table[1 << kLGLZHashBits];
+    memset(table, 0, sizeof(table));
+
+    uint8_t *op = dst;
+    size_t ip = 0;
+    size_t anchor = 0;
+    while (ip + kLGLZMinMatch <= srcLength) {
+        uint32_t sequence;
+        memcpy(&sequence, src + ip, sizeof(sequence));
+        uint32_t hash = LGLZHash(sequence);
+        size_t candidate = table[hash];
+        table[hash] = (uint32_t)(ip + 1);
+        if (candidate && ip - (candidate - 1) <= kLGLZMaxOffset &&
+            memcmp(src + candidate - 1, src + ip, kLGLZMinMatch) == 0) {
+            size_t reference = candidate - 1;
+            size_t matchLength = kLGLZMinMatch;
+            while (ip + matchLength < srcLength && src[reference + matchLength] == src[ip + matchLength]) {
+                matchLength++;
+            }
+            op = LGLZWriteSequence(op, src + anchor, ip - anchor, ip - reference, matchLength);
+            ip += matchLength;
+            anchor = ip;
+        } else {
+            ip++;
+        }
+    }
+    op = LGLZWriteSequence(op, src + anchor, srcLength - anchor, 0, 0);
+    return op - dst;
+}
+
+static BOOL LGLZReadLength(const uint8_t **ip, const uint8_t *ipEnd, size_t *length)
+{
+    uint8_t byte;
+    do {
+        if (*ip >= ipEnd) {
+            return NO;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return YES;
+}
+
+static BOOL LGLZDecompress(const uint8_t *src, size_t srcLength, uint8_t *dst, size_t dstLength)
+{
+    const uint8_t *ip = src;
+    const uint8_t *ipEnd = src + srcLength;
+    uint8_t *op = dst;
+    uint8_t *opEnd = dst + dstLength;
+
+    while (ip < ipEnd) {
+        uint8_t token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !LGLZReadLength(&ip, ipEnd, &literalLength)) {
+            return NO;
+        }
+        if (literalLength > (size_t)(ipEnd - ip) || literalLength > (size_t)(opEnd - op)) {
+            return NO;
+        }
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == ipEnd) {
+            break;
+        }
+        if (ipEnd - ip < 2) {
+            return NO;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return NO;
+        }
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !LGLZReadLength(&ip, ipEnd, &matchLength)) {
+            return NO;
+        }
+        matchLength += kLGLZMinMatch;
+        if (matchLength > (size_t)(opEnd - op)) {
+            return NO;
+        }
+        // Byte by byte copy, match may overlap output
+        const uint8_t *match = op - offset;
+        while (matchLength--) {
+            *op++ = *match++;
+        }
+    }
+    return op == opEnd;
+}
+
+static NSError *LGCodecMalformedDataError()
+{
+    return [NSError errorWithDomain:kLGCodecErrorDomain
+                               code:kLGCodecMalformedDataErrorCode
+                           userInfo:@{kLGErrorMessageKey : kLGCodecMalformedDataErrorMessage}];
+}
+
+/*----------------------------------------------------*/
+#pragma mark - LGLZCodec -
+/*----------------------------------------------------*/
+
+@implementation LGLZCodec
+
+- (NSData *)encodeData:(NSData *)aData
+{
+    NSUInteger length = [aData length];
+    if (length <= UINT32_MAX) {
+        NSMutableData *encoded = [NSMutableData dataWithLength:kLGLZHeaderLength + LGLZCompressBound(length)];
+        uint8_t *bytes = [encoded mutableBytes];
+        size_t compressedLength = LGLZCompress([aData bytes], length, bytes + kLGLZHeaderLength);
+        if (kLGLZHeaderLength + compressedLength < 1 + length) {
+            bytes[0] = kLGLZMethodLZ;
+            bytes[1] = (uint8_t)(length);
+            bytes[2] = (uint8_t)(length >> 8);
+            bytes[3] = (uint8_t)(length >> 16);
+            bytes[4] = (uint8_t)(length >> 24);
+            [encoded setLength:kLGLZHeaderLength + compressedLength];
+            return encoded;
+        }
+    }
+    // Not compressable, storing as is
+    NSMutableData *stored = [NSMutableData dataWithCapacity:1 + length];
+    uint8_t method = kLGLZMethodStored;
+    [stored appendBytes:&method length:1];
+    [stored appendData:aData];
+    return stored;
+}
+
+- (NSData *)decodeData:(NSData *)aData error:(NSError **)anError
+{
+    const uint8_t *bytes = [aData bytes];
+    NSUInteger length = [aData length];
+    if (length >= 1 && bytes[0] == kLGLZMethodStored) {
+        return [aData subdataWithRange:NSMakeRange(1, length - 1)];
+    }
+    if (length >= kLGLZHeaderLength && bytes[0] == kLGLZMethodLZ) {
+        size_t rawLength = (size_t)bytes[1] | ((size_t)bytes[2] << 8) |
+                           ((size_t)bytes[3] << 16) | ((size_t)bytes[4] << 24);
+        // Single encoded byte can't expand to more than 255 bytes,
+        // rejecting corrupted headers before allocating
+        NSMutableData *decoded = nil;
+        if (rawLength / 255 <= length) {
+            decoded = [NSMutableData dataWithLength:rawLength];
+        }
+        if (decoded && LGLZDecompress(bytes + kLGLZHeaderLength, length - kLGLZHeaderLength,
+                           [decoded mutableBytes], rawLength)) {
+            return decoded;
+        }
+    }
+    if (anError) {
+        *anError = LGCodecMalformedDataError();
+    }
+    return nil;
+}
+
+@end
+
+/*----------------------------------------------------*/
+#pragma mark - LGDeltaCodec -
+/*----------------------------------------------------*/
+
+// Every delta payload starts with frame byte
+#define kLGDeltaFrameKey    0
+#define kLGDeltaFrameDelta  1
+
+@interface LGDeltaCodec ()
+
+@property (strong, nonatomic) NSData *lastEncodedValue;
+
+@property (strong, nonatomic) NSData *lastDecodedValue;
+
+@end
+
+@implementation LGDeltaCodec
+
+- (void)reset
+{
+    // Decoding reference is kept, peer's encoder wasn't reset
+    self.lastEncodedValue = nil;
+}
+
+/**
+ * XOR-es aData with aReference, bytes out of aReference range are kept as is
+ */
+- (NSData *)data:(NSData *)aData xorWithReference:(NSData *)aReference
+{
+    NSMutableData *result = [aData mutableCopy];
+    uint8_t *bytes = [result mutableBytes];
+    const uint8_t *reference = [aReference bytes];
+    NSUInteger overlap = MIN([result length], [aReference length]);
+    for (NSUInteger i = 0; i < overlap; i++) {
+        bytes[i] ^= reference[i];
+    }
+    return result;
+}
+
+- (NSData *)encodeData:(NSData *)aData
+{
+    uint8_t frame = self.lastEncodedValue ? kLGDeltaFrameDelta : kLGDeltaFrameKey;
+    NSMutableData *encoded = [NSMutableData dataWithCapacity:1 + [aData length]];
+    [encoded appendBytes:&frame length:1];
+    [encoded appendData:[self data:aData xorWithReference:self.lastEncodedValue]];
+    self.lastEncodedValue = [aData copy];
+    return encoded;
+}
+
+- (NSData *)decodeData:(NSData *)aData error:(NSError **)anError
+{
+    const uint8_t *bytes = [aData bytes];
+    NSUInteger length = [aData length];
+    NSData *decoded = nil;
+    if (length >= 1 && bytes[0] == kLGDeltaFrameKey) {
+        decoded = [aData subdataWithRange:NSMakeRange(1, length - 1)];
+    } else if (length >= 1 && bytes[0] == kLGDeltaFrameDelta && self.lastDecodedValue) {
+        decoded = [self data:[aData subdataWithRange:NSMakeRange(1, length - 1)]
+            xorWithReference:self.lastDecodedValue];
+    }
+    if (!decoded) {
+        // Delta without reference can't be restored, waiting for keyframe
+        if (anError) {
+            *anError = LGCodecMalformedDataError();
+        }
+        return nil;
+    }
+    self.lastDecodedValue = decoded;
+    return decoded;
+}
+
+@end
@@ -0,0 +1,146 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGCodec.h"
+
+typedef void(^LGCodecPipelineEncodeCallback)(NSData *data);
+typedef void(^LGCodecPipelineDecodeCallback)(NSData *data, NSError *error);
+
+/**
+ * Ordered chain of LGCodec stages, which can be attached to characteristic.
+ * Outgoing payloads are passed through codecs in order, incoming ones in reverse order.
+ * Coding happens on pipeline's serial queue, results are delivered on main queue
+ * in the same order as they were submitted
+ */
+@interface LGCodecPipeline : NSObject
+
+/**
+ * Codec stages (objects conforming to LGCodec protocol)
+ */
+@property (strong, nonatomic, readonly) NSArray *codecs;
+
+#pragma mark - Statistics -
+
+// ----- Updated on main queue, KVO observable -----/
+
+/**
+ * Total count of raw (application side) bytes passed through pipeline
+ */
+@property (assign, nonatomic, readonly) unsigned long long rawBytes;
+
+/**
+ * Total count of encoded (over the air) bytes passed through pipeline
+ */
+@property (assign, nonatomic, readonly) unsigned long long encodedBytes;
+
+/**
+ * rawBytes / encodedBytes, values above 1 mean saved airtime
+ */
+@property (assign, nonatomic, readonly) double compressionRatio;
+
+/**
+ * Total time spent in codecs
+ */
+@property (assign, nonatomic, readonly) NSTimeInterval codingTime;
+
+/**
+ * Raw bytes per second processed by codecs
+ */
+@property (assign, nonatomic, readonly) double codingThroughput;
+
+/**
+ * Total count of raw bytes which were transfered successfully
+ */
+@property (assign, nonatomic, readonly) unsigned long long transferredBytes;
+
+/**
+ * Total time from ble-operation request till its response
+ */
+@property (assign, nonatomic, readonly) NSTimeInterval transferTime;
+
+/**
+ * Raw bytes per second delivered over the air (after coding)
+ */
+@property (assign, nonatomic, readonly) double effectiveThroughput;
+
+#pragma mark - Public Methods -
+
+/**
+ * Encodes outgoing payload off the callback queue
+ * @param aData raw bytes which needs to be sent
+ * @param aCallback Will be called on main queue with encoded bytes
+ */
+- (void)encodeData:(NSData *)aData
+        completion:(LGCodecPipelineEncodeCallback)aCallback;
+
+/**
+ * Decodes incoming payload off the callback queue
+ * @param aData encoded bytes which were received, nil is passed through
+ * @param aCallback Will be called on main queue with decoded bytes or decoding error
+ */
+- (void)decodeData:(NSData *)aData
+        completion:(LGCodecPipelineDecodeCallback)aCallback;
+
+/**
+ * Calls aBlock on main queue after all earlier submitted payloads were delivered,
+ * used to keep operations in the order they were issued
+ */
+- (void)performAfterPendingCoding:(dispatch_block_t)aBlock;
+
+/**
+ * Resets stateful codecs (e.g. LGDeltaCodec), after already submitted payloads.
+ * Called by LGBluetooth after disconnects and failed writes
+ */
+- (void)reset;
+
+/**
+ * Accounts successful transfer of raw bytes into effectiveThroughput
+ * @param aLength count of raw (not encoded) bytes
+ * @param aDuration interval from ble-operation request till its response
+ */
+- (void)recordTransferOfRawBytes:(NSUInteger)aLength
+                        duration:(NSTimeInterval)aDuration;
+
+/**
+ * Zeroes all statistics
+ */
+- (void)resetStatistics;
+
+#pragma mark - Lifecycle -
+
+/**
+ * @return Pipeline with single LGLZCodec stage
+ */
++ (instancetype)compressionPipeline;
+
+/**
+ * @return Pipeline with LGDeltaCodec followed by LGLZCodec
+ */
++ (instancetype)deltaCompressionPipeline;
+
+/**
+ * @param aCodecs Array of objects conforming to LGCodec protocol
+ * @return Pipeline which applies aCodecs in order
+ */
+- (instancetype)initWithCodecs:(NSArray *)aCodecs;
+
+@end
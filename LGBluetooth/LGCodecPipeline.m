@@ -0,0 +1,209 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGCodecPipeline.h"
+
+#import "LGUtils.h"
+
+@interface LGCodecPipeline ()
+
+/**
+ * Serial queue on which codecs are invoked
+ */
+@property (strong, nonatomic) dispatch_queue_t codecQueue;
+
+@property (assign, nonatomic, readwrite) unsigned long long rawBytes;
+
+@property (assign, nonatomic, readwrite) unsigned long long encodedBytes;
+
+@property (assign, nonatomic, readwrite) NSTimeInterval codingTime;
+
+@property (assign, nonatomic, readwrite) unsigned long long transferredBytes;
+
+@property (assign, nonatomic, readwrite) NSTimeInterval transferTime;
+
+@end
+
+@implementation LGCodecPipeline
+
+/*----------------------------------------------------*/
+#pragma mark - Getter/Setter -
+/*----------------------------------------------------*/
+
+- (double)compressionRatio
+{
+    return self.encodedBytes ? (double)self.rawBytes / self.encodedBytes : 1.0;
+}
+
+- (double)codingThroughput
+{
+    return self.codingTime > 0 ? self.rawBytes / self.codingTime : 0;
+}
+
+- (double)effectiveThroughput
+{
+    return self.transferTime > 0 ? self.transferredBytes / self.transferTime : 0;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - KVO -
+/*----------------------------------------------------*/
+
++ (NSSet *)keyPathsForValuesAffectingCompressionRatio
+{
+    return [NSSet setWithObjects:@"rawBytes", @"encodedBytes", nil];
+}
+
++ (NSSet *)keyPathsForValuesAffectingCodingThroughput
+{
+    return [NSSet setWithObjects:@"rawBytes", @"codingTime", nil];
+}
+
++ (NSSet *)keyPathsForValuesAffectingEffectiveThroughput
+{
+    return [NSSet setWithObjects:@"transferredBytes", @"transferTime", nil];
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Public Methods -
+/*----------------------------------------------------*/
+
+- (void)encodeData:(NSData *)aData
+        completion:(LGCodecPipelineEncodeCallback)aCallback
+{
+    dispatch_async(self.codecQueue, ^{
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSData *encoded = aData;
+        for (id<LGCodec> codec in self.codecs) {
+            encoded = [codec encodeData:encoded];
+        }
+        NSTimeInterval duration = CFAbsoluteTimeGetCurrent() - start;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self accountRawLength:[aData length] encodedLength:[encoded length] duration:duration];
+            LGLog(@"Encoded %lu bytes to %lu bytes", (unsigned long)[aData length], (unsigned long)[encoded length]);
+            if (aCallback) {
+                aCallback(encoded);
+            }
+        });
+    });
+}
+
+- (void)decodeData:(NSData *)aData
+        completion:(LGCodecPipelineDecodeCallback)aCallback
+{
+    dispatch_async(self.codecQueue, ^{
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSData *decoded = aData;
+        NSError *error = nil;
+        if (aData) {
+            for (id<LGCodec> codec in [self.codecs reverseObjectEnumerator]) {
+                decoded = [codec decodeData:decoded error:&error];
+                if (!decoded) {
+                    break;
+                }
+            }
+        }
+        NSTimeInterval duration = CFAbsoluteTimeGetCurrent() - start;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self accountRawLength:[decoded length] encodedLength:[aData length] duration:duration];
+            if (error) {
+                LGLogError(@"Failed to decode payload - %@", error);
+            }
+            if (aCallback) {
+                aCallback(decoded, error);
+            }
+        });
+    });
+}
+
+- (void)performAfterPendingCoding:(dispatch_block_t)aBlock
+{
+    // Serial queue, so block is delivered after results of earlier payloads
+    dispatch_async(self.codecQueue, ^{
+        dispatch_async(dispatch_get_main_queue(), aBlock);
+    });
+}
+
+- (void)reset
+{
+    dispatch_async(self.codecQueue, ^{
+        for (id<LGCodec> codec in self.codecs) {
+            if ([codec respondsToSelector:@selector(reset)]) {
+                [codec reset];
+            }
+        }
+    });
+}
+
+- (void)recordTransferOfRawBytes:(NSUInteger)aLength
+                        duration:(NSTimeInterval)aDuration
+{
+    self.transferredBytes += aLength;
+    self.transferTime += aDuration;
+}
+
+- (void)resetStatistics
+{
+    self.rawBytes = 0;
+    self.encodedBytes = 0;
+    self.codingTime = 0;
+    self.transferredBytes = 0;
+    self.transferTime = 0;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Private Methods -
+/*----------------------------------------------------*/
+
+- (void)accountRawLength:(NSUInteger)aRawLength
+           encodedLength:(NSUInteger)anEncodedLength
+                duration:(NSTimeInterval)aDuration
+{
+    self.rawBytes += aRawLength;
+    self.encodedBytes += anEncodedLength;
+    self.codingTime += aDuration;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Lifecycle -
+/*----------------------------------------------------*/
+
++ (instancetype)compressionPipeline
+{
+    return [[self alloc] initWithCodecs:@[[LGLZCodec new]]];
+}
+
++ (instancetype)deltaCompressionPipeline
+{
+    return [[self alloc] initWithCodecs:@[[LGDeltaCodec new], [LGLZCodec new]]];
+}
+
+- (instancetype)initWithCodecs:(NSArray *)aCodecs
+{
+    if (self = [super init]) {
+        _codecs = [aCodecs copy];
+        _codecQueue = dispatch_queue_create("com.LGBluetooth.LGCodecQueue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+@end
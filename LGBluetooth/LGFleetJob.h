@@ -0,0 +1,206 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+@class LGPeripheral;
+
+#pragma mark - Error Domains -
+
+/**
+ * Error domain for fleet job errors
+ */
+extern NSString * const kLGFleetJobErrorDomain;
+
+#pragma mark - Error Codes -
+
+/**
+ * Device wasn't processed before its deadline
+ */
+extern const NSInteger kLGFleetJobTimeoutErrorCode;
+
+/**
+ * Job was canceled before device was processed
+ */
+extern const NSInteger kLGFleetJobCanceledErrorCode;
+
+#pragma mark - Error Messages -
+
+/**
+ * Error message for devices which exceeded deadline
+ */
+extern NSString * const kLGFleetJobTimeoutErrorMessage;
+
+/**
+ * Error message for devices of canceled job
+ */
+extern NSString * const kLGFleetJobCanceledErrorMessage;
+
+#pragma mark - Callback types -
+
+@class LGFleetDeviceResult;
+
+/**
+ * @param data result of step, nil for steps without result
+ * @param bytesTransferred count of written/read bytes
+ */
+typedef void(^LGFleetStepCallback)(NSData *data, NSUInteger bytesTransferred, NSError *error);
+typedef void(^LGFleetStep)(LGPeripheral *peripheral, LGFleetStepCallback aCallback);
+typedef void(^LGFleetDeviceCallback)(LGFleetDeviceResult *result);
+typedef void(^LGFleetJobCallback)(NSArray *results);
+
+#pragma mark - LGFleetDeviceResult -
+
+/**
+ * Outcome of operation sequence on single peripheral
+ */
+@interface LGFleetDeviceResult : NSObject
+
+@property (strong, nonatomic, readonly) LGPeripheral *peripheral;
+
+/**
+ * Data returned by each step (NSNull for steps without data),
+ * partial if device failed
+ */
+@property (strong, nonatomic, readonly) NSArray *stepResults;
+
+/**
+ * Error of the last attempt, nil on success
+ */
+@property (strong, nonatomic, readonly) NSError *error;
+
+/**
+ * Count of attempts made (1 + retries)
+ */
+@property (assign, nonatomic, readonly) NSUInteger attempts;
+
+/**
+ * Interval from device start till its result
+ */
+@property (assign, nonatomic, readonly) NSTimeInterval duration;
+
+/**
+ * Count of written and read bytes
+ */
+@property (assign, nonatomic, readonly) NSUInteger bytesTransferred;
+
+@end
+
+#pragma mark - LGFleetJob -
+
+/**
+ * Applies the same operation sequence to many peripherals with bounded parallelism.
+ * Steps of single device are performed one after another,
+ * failed devices are retried from the first step.
+ * NOTE : Should be used from main queue only (as all LGBluetooth callbacks)
+ */
+@interface LGFleetJob : NSObject
+
+/**
+ * Peripherals on which job is applied
+ */
+@property (strong, nonatomic, readonly) NSArray *peripherals;
+
+/**
+ * Steps (LGFleetStep blocks) which are performed on every peripheral
+ */
+@property (strong, nonatomic, readonly) NSArray *steps;
+
+/**
+ * Max count of devices processed at once, default is 4
+ */
+@property (assign, nonatomic) NSUInteger maxConcurrentDevices;
+
+/**
+ * Count of retries after failed attempt, default is 2
+ */
+@property (assign, nonatomic) NSUInteger maxRetries;
+
+/**
+ * Max interval for processing single device (all attempts), default is 60 seconds
+ */
+@property (assign, nonatomic) NSTimeInterval deviceTimeout;
+
+/**
+ * Disconnect from peripheral after it was processed, default is YES
+ */
+@property (assign, nonatomic) BOOL disconnectsOnCompletion;
+
+#pragma mark - Progress -
+
+// ----- Updated on main queue, KVO observable -----/
+
+@property (assign, nonatomic, readonly) NSUInteger succeededCount;
+
+@property (assign, nonatomic, readonly) NSUInteger failedCount;
+
+/**
+ * Part of processed devices (0..1)
+ */
+@property (assign, nonatomic, readonly) double progress;
+
+/**
+ * Transferred bytes per second since job was started
+ */
+@property (assign, nonatomic, readonly) double throughput;
+
+/**
+ * Count of failed devices by "<error domain>:<error code>" keys
+ */
+@property (strong, nonatomic, readonly) NSDictionary *failureBreakdown;
+
+#pragma mark - Steps -
+
+/**
+ * @return Step which writes aData via LGUtils (connecting if needed)
+ */
++ (LGFleetStep)writeStepWithData:(NSData *)aData
+                     charactUUID:(NSString *)aCharacteristic
+                     serviceUUID:(NSString *)aService;
+
+/**
+ * @return Step which reads value via LGUtils (connecting if needed)
+ */
++ (LGFleetStep)readStepWithCharactUUID:(NSString *)aCharacteristic
+                           serviceUUID:(NSString *)aService;
+
+#pragma mark - Public Methods -
+
+/**
+ * Starts job
+ * @param aDeviceCallback will be called as soon as each device finishes
+ * @param aCallback will be called after all devices finished, with results in peripherals order
+ */
+- (void)startWithDeviceCompletion:(LGFleetDeviceCallback)aDeviceCallback
+                       completion:(LGFleetJobCallback)aCallback;
+
+/**
+ * Fails all devices which weren't finished yet with cancel error
+ */
+- (void)cancel;
+
+/**
+ * @param aPeripherals LGPeripheral objects on which job is applied
+ * @param aSteps LGFleetStep blocks, performed in order on every peripheral
+ */
+- (instancetype)initWithPeripherals:(NSArray *)aPeripherals
+                              steps:(NSArray *)aSteps;
+
+@end
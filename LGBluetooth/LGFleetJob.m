@@ -0,0 +1,382 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGFleetJob.h"
+
+#if TARGET_OS_IPHONE
+#import <CoreBluetooth/CoreBluetooth.h>
+#elif TARGET_OS_MAC
+#import <IOBluetooth/IOBluetooth.h>
+#endif
+#import "LGPeripheral.h"
+#import "LGUtils.h"
+
+// Error Domains
+NSString * const kLGFleetJobErrorDomain = @"LGFleetJobErrorDomain";
+
+// Error Codes
+const NSInteger kLGFleetJobTimeoutErrorCode  = 440;
+const NSInteger kLGFleetJobCanceledErrorCode = 441;
+
+NSString * const kLGFleetJobTimeoutErrorMessage  = @"Device wasn't processed by given interval";
+NSString * const kLGFleetJobCanceledErrorMessage = @"Job was canceled";
+
+/*----------------------------------------------------*/
+#pragma mark - LGFleetDeviceResult -
+/*----------------------------------------------------*/
+
+@interface LGFleetDeviceResult ()
+
+@property (strong, nonatomic, readwrite) LGPeripheral *peripheral;
+
+@property (strong, nonatomic) NSMutableArray *mutableStepResults;
+
+@property (strong, nonatomic, readwrite) NSError *error;
+
+@property (assign, nonatomic, readwrite) NSUInteger attempts;
+
+@property (assign, nonatomic, readwrite) NSTimeInterval duration;
+
+@property (assign, nonatomic, readwrite) NSUInteger bytesTransferred;
+
+@property (assign, nonatomic) CFAbsoluteTime startTime;
+
+@property (assign, nonatomic, getter = isStarted) BOOL started;
+
+@property (assign, nonatomic, getter = isFinished) BOOL finished;
+
+@end
+
+@implementation LGFleetDeviceResult
+
+- (NSArray *)stepResults
+{
+    return [self.mutableStepResults copy];
+}
+
+- (NSString *)description
+{
+    NSString *org = [super description];
+    
+    return [org stringByAppendingFormat:@" UUIDString: %@ attempts: %lu error: %@",
+            self.peripheral.UUIDString, (unsigned long)self.attempts, self.error];
+}
+
+@end
+
+/*----------------------------------------------------*/
+#pragma mark - LGFleetJob -
+/*----------------------------------------------------*/
+
+@interface LGFleetJob ()
+
+@property (strong, nonatomic) NSArray *results;
+
+@property (copy, nonatomic) LGFleetDeviceCallback deviceBlock;
+
+@property (copy, nonatomic) LGFleetJobCallback completionBlock;
+
+@property (assign, nonatomic) NSUInteger nextDeviceIndex;
+
+@property (assign, nonatomic) NSUInteger runningCount;
+
+@property (assign, nonatomic) NSUInteger totalBytes;
+
+@property (assign, nonatomic) CFAbsoluteTime startTime;
+
+@property (assign, nonatomic) CFAbsoluteTime finishTime;
+
+@property (assign, nonatomic, getter = isCanceled) BOOL canceled;
+
+@property (assign, nonatomic, readwrite) NSUInteger succeededCount;
+
+@property (assign, nonatomic, readwrite) NSUInteger failedCount;
+
+@property (strong, nonatomic, readwrite) NSDictionary *failureBreakdown;
+
+@end
+
+@implementation LGFleetJob
+
+/*----------------------------------------------------*/
+#pragma mark - Getter/Setter -
+/*----------------------------------------------------*/
+
+- (double)progress
+{
+    NSUInteger count = [self.peripherals count];
+    return count ? (double)(self.succeededCount + self.failedCount) / count : 1.0;
+}
+
+- (double)throughput
+{
+    if (!self.startTime) {
+        return 0;
+    }
+    CFAbsoluteTime now = self.finishTime ? : CFAbsoluteTimeGetCurrent();
+    return now > self.startTime ? self.totalBytes / (now - self.startTime) : 0;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - KVO -
+/*----------------------------------------------------*/
+
++ (NSSet *)keyPathsForValuesAffectingProgress
+{
+    return [NSSet setWithObjects:@"succeededCount", @"failedCount", nil];
+}
+
++ (NSSet *)keyPathsForValuesAffectingThroughput
+{
+    return [NSSet setWithObjects:@"totalBytes", @"finishTime", nil];
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Steps -
+/*----------------------------------------------------*/
+
++ (LGFleetStep)writeStepWithData:(NSData *)aData
+                     charactUUID:(NSString *)aCharacteristic
+                     serviceUUID:(NSString *)aService
+{
+    return ^(LGPeripheral *peripheral, LGFleetStepCallback aCallback) {
+        [LGUtils writeData:aData
+               charactUUID:aCharacteristic
+               serviceUUID:aService
+                peripheral:peripheral
+                completion:^(NSError *error) {
+                    aCallback(nil, error ? 0 : [aData length], error);
+                }];
+    };
+}
+
++ (LGFleetStep)readStepWithCharactUUID:(NSString *)aCharacteristic
+                           serviceUUID:(NSString *)aService
+{
+    return ^(LGPeripheral *peripheral, LGFleetStepCallback aCallback) {
+        [LGUtils readDataFromCharactUUID:aCharacteristic
+                             serviceUUID:aService
+                              peripheral:peripheral
+                              completion:^(NSData *data, NSError *error) {
+                                  aCallback(data, [data length], error);
+                              }];
+    };
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Public Methods -
+/*----------------------------------------------------*/
+
+- (void)startWithDeviceCompletion:(LGFleetDeviceCallback)aDeviceCallback
+                       completion:(LGFleetJobCallback)aCallback
+{
+    self.deviceBlock = aDeviceCallback;
+    self.completionBlock = aCallback;
+    self.startTime = CFAbsoluteTimeGetCurrent();
+    
+    NSMutableArray *results = [NSMutableArray new];
+    for (LGPeripheral *peripheral in self.peripherals) {
+        LGFleetDeviceResult *result = [LGFleetDeviceResult new];
+        result.peripheral = peripheral;
+        result.mutableStepResults = [NSMutableArray new];
+        [results addObject:result];
+    }
+    self.results = results;
+    
+    if (![results count]) {
+        [self finishJob];
+        return;
+    }
+    [self startNextDevices];
+}
+
+- (void)cancel
+{
+    self.canceled = YES;
+    for (LGFleetDeviceResult *result in self.results) {
+        if (!result.isFinished) {
+            [self finishDevice:result error:[self errorWithCode:kLGFleetJobCanceledErrorCode
+                                                        message:kLGFleetJobCanceledErrorMessage]];
+        }
+    }
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Private Methods -
+/*----------------------------------------------------*/
+
+- (void)startNextDevices
+{
+    while (!self.isCanceled &&
+           self.runningCount < MAX(self.maxConcurrentDevices, 1) &&
+           self.nextDeviceIndex < [self.results count]) {
+        LGFleetDeviceResult *result = self.results[self.nextDeviceIndex++];
+        if (result.isFinished) {
+            continue;
+        }
+        self.runningCount++;
+        result.started = YES;
+        result.startTime = CFAbsoluteTimeGetCurrent();
+        
+        __weak LGFleetJob *weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.deviceTimeout * NSEC_PER_SEC)),
+                       dispatch_get_main_queue(), ^{
+                           if (!result.isFinished) {
+                               [weakSelf finishDevice:result error:[weakSelf errorWithCode:kLGFleetJobTimeoutErrorCode
+                                                                                   message:kLGFleetJobTimeoutErrorMessage]];
+                           }
+                       });
+        [self startAttemptForDevice:result];
+    }
+}
+
+- (void)startAttemptForDevice:(LGFleetDeviceResult *)aResult
+{
+    aResult.attempts++;
+    [aResult.mutableStepResults removeAllObjects];
+    [self performStepAtIndex:0 device:aResult attempt:aResult.attempts];
+}
+
+- (void)performStepAtIndex:(NSUInteger)anIndex
+                    device:(LGFleetDeviceResult *)aResult
+                   attempt:(NSUInteger)anAttempt
+{
+    if (anIndex == [self.steps count]) {
+        [self finishDevice:aResult error:nil];
+        return;
+    }
+    LGFleetStep step = self.steps[anIndex];
+    step(aResult.peripheral, ^(NSData *data, NSUInteger bytesTransferred, NSError *error) {
+        // Late callbacks of timed out or retried attempts are ignored
+        if (aResult.isFinished || aResult.attempts != anAttempt) {
+            return;
+        }
+        aResult.bytesTransferred += bytesTransferred;
+        self.totalBytes += bytesTransferred;
+        if (error) {
+            [self handleFailureOfDevice:aResult error:error];
+        } else {
+            [aResult.mutableStepResults addObject:data ? : [NSNull null]];
+            [self performStepAtIndex:anIndex + 1 device:aResult attempt:anAttempt];
+        }
+    });
+}
+
+- (void)handleFailureOfDevice:(LGFleetDeviceResult *)aResult error:(NSError *)anError
+{
+    LGLogError(@"Fleet job attempt %lu failed on %@ - %@",
+               (unsigned long)aResult.attempts, aResult.peripheral.UUIDString, anError);
+    if (aResult.attempts > self.maxRetries) {
+        [self finishDevice:aResult error:anError];
+        return;
+    }
+    // Retrying from scratch, over the new connection
+    if (aResult.peripheral.cbPeripheral.state != CBPeripheralStateDisconnected) {
+        NSUInteger attempt = aResult.attempts;
+        [aResult.peripheral disconnectWithCompletion:^(NSError *error) {
+            if (!aResult.isFinished && aResult.attempts == attempt) {
+                [self startAttemptForDevice:aResult];
+            }
+        }];
+    } else {
+        [self startAttemptForDevice:aResult];
+    }
+}
+
+- (void)finishDevice:(LGFleetDeviceResult *)aResult error:(NSError *)anError
+{
+    aResult.finished = YES;
+    aResult.error = anError;
+    if (aResult.isStarted) {
+        aResult.duration = CFAbsoluteTimeGetCurrent() - aResult.startTime;
+        self.runningCount--;
+        if (self.disconnectsOnCompletion &&
+            aResult.peripheral.cbPeripheral.state != CBPeripheralStateDisconnected) {
+            [aResult.peripheral disconnectWithCompletion:nil];
+        }
+    }
+    
+    if (anError) {
+        self.failedCount++;
+        NSString *key = [NSString stringWithFormat:@"%@:%ld", anError.domain, (long)anError.code];
+        NSMutableDictionary *breakdown = [self.failureBreakdown mutableCopy];
+        breakdown[key] = @([breakdown[key] unsignedIntegerValue] + 1);
+        self.failureBreakdown = breakdown;
+    } else {
+        self.succeededCount++;
+    }
+    
+    if (self.deviceBlock) {
+        self.deviceBlock(aResult);
+    }
+    
+    if (self.succeededCount + self.failedCount == [self.results count]) {
+        [self finishJob];
+    } else {
+        [self startNextDevices];
+    }
+}
+
+- (void)finishJob
+{
+    self.finishTime = CFAbsoluteTimeGetCurrent();
+    LGLog(@"Fleet job finished, %lu succeeded, %lu failed, %.0f bytes/sec",
+          (unsigned long)self.succeededCount, (unsigned long)self.failedCount, self.throughput);
+    LGFleetJobCallback callback = self.completionBlock;
+    self.deviceBlock = nil;
+    self.completionBlock = nil;
+    if (callback) {
+        callback(self.results);
+    }
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Error Generators -
+/*----------------------------------------------------*/
+
+- (NSError *)errorWithCode:(NSInteger)aCode message:(NSString *)aMsg
+{
+    return [NSError errorWithDomain:kLGFleetJobErrorDomain
+                               code:aCode
+                           userInfo:@{kLGErrorMessageKey : aMsg}];
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Lifecycle -
+/*----------------------------------------------------*/
+
+- (instancetype)initWithPeripherals:(NSArray *)aPeripherals
+                              steps:(NSArray *)aSteps
+{
+    if (self = [super init]) {
+        _peripherals = [aPeripherals copy];
+        _steps = [aSteps copy];
+        _maxConcurrentDevices = 4;
+        _maxRetries = 2;
+        _deviceTimeout = 60;
+        _disconnectsOnCompletion = YES;
+        _failureBreakdown = @{};
+    }
+    return self;
+}
+
+@end
@@ -0,0 +1,217 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma mark - Error Domains -
+
+/**
+ * Error domain for operations which were dropped by scheduler
+ */
+extern NSString * const kLGOperationSchedulerErrorDomain;
+
+#pragma mark - Error Codes -
+
+/**
+ * Operation was sent, but response didn't come in responseTimeout
+ */
+extern const NSInteger kLGOperationTimeoutErrorCode;
+
+/**
+ * Operation was canceled (e.g. by disconnect)
+ */
+extern const NSInteger kLGOperationCanceledErrorCode;
+
+/**
+ * Operation was requested while peripheral isn't connected
+ */
+extern const NSInteger kLGOperationNotConnectedErrorCode;
+
+#pragma mark - Error Messages -
+
+extern NSString * const kLGOperationTimeoutErrorMessage;
+
+extern NSString * const kLGOperationCanceledErrorMessage;
+
+extern NSString * const kLGOperationNotConnectedErrorMessage;
+
+/**
+ * Priority classes of ble-operations, lower value is served first
+ */
+typedef NS_ENUM(NSInteger, LGOperationPriority) {
+    /**
+     * Urgent control commands (e.g. stop-motor), always served first
+     */
+    LGOperationPriorityControl = 0,
+    /**
+     * Regular operations
+     */
+    LGOperationPriorityDefault,
+    /**
+     * Long bulk transfers, served when nothing else is waiting
+     */
+    LGOperationPriorityBulk,
+};
+
+/**
+ * Types of ble-operations, used to match responses with in-flight operations
+ */
+typedef NS_ENUM(NSInteger, LGOperationType) {
+    LGOperationTypeRead,
+    LGOperationTypeWrite,
+    LGOperationTypeNotify,
+    LGOperationTypeDiscoverServices,
+    LGOperationTypeDiscoverCharacteristics,
+    LGOperationTypeReadRSSI,
+};
+
+typedef BOOL(^LGOperationSchedulerReadinessCallback)(void);
+typedef void(^LGOperationSchedulerFailureCallback)(NSError *error);
+
+/**
+ * Per-peripheral scheduler, through which all GATT operations are issued.
+ * Operations are served by priority classes, inside of the same class
+ * operations of different attributes (characteristics/services) are round-robin interleaved.
+ * At most pipeliningDepth operations are waiting for response at once, and at most
+ * writeWithoutResponseWindow writes without response per class are handed to CoreBluetooth
+ * until it can take more, and operations which don't get response in responseTimeout are dropped,
+ * so control operation waits only for a bounded count of sent operations.
+ * NOTE : Should be used from main queue only (as all LGBluetooth callbacks)
+ */
+@interface LGOperationScheduler : NSObject
+
+/**
+ * Max count of operations which are sent to peripheral and wait for response,
+ * default is 1
+ */
+@property (assign, nonatomic) NSUInteger pipeliningDepth;
+
+/**
+ * Max count of writes without response of one priority class sent to peripheral
+ * before window is refilled (by handleReadyToSendWriteWithoutResponse or
+ * after writeWithoutResponseRefillInterval), default is 8
+ */
+@property (assign, nonatomic) NSUInteger writeWithoutResponseWindow;
+
+/**
+ * Interval after which write without response windows are refilled, if
+ * peripheral doesn't report readiness earlier, default is 0.01 sec
+ */
+@property (assign, nonatomic) NSTimeInterval writeWithoutResponseRefillInterval;
+
+/**
+ * Interval after which sent operation which didn't get response is failed with
+ * kLGOperationTimeoutErrorCode, 0 disables timeouts, default is 10 sec
+ */
+@property (assign, nonatomic) NSTimeInterval responseTimeout;
+
+/**
+ * Optional block which tells if peripheral is connected. Operations requested
+ * while it returns NO fail with kLGOperationNotConnectedErrorCode, waiting ones aren't sent
+ */
+@property (copy, nonatomic) LGOperationSchedulerReadinessCallback connectionReadinessBlock;
+
+/**
+ * Optional block which tells if peripheral can take write without response now
+ * (e.g. CBPeripheral's canSendWriteWithoutResponse), writes wait while it returns NO
+ */
+@property (copy, nonatomic) LGOperationSchedulerReadinessCallback writeWithoutResponseReadinessBlock;
+
+/**
+ * Count of operations waiting in queue (not yet sent to peripheral)
+ */
+@property (assign, nonatomic, readonly) NSUInteger queueDepth;
+
+/**
+ * Count of operations sent to peripheral and waiting for response
+ */
+@property (assign, nonatomic, readonly) NSUInteger inFlightCount;
+
+#pragma mark - Statistics -
+
+/**
+ * @return Count of operations of aPriority waiting in queue
+ */
+- (NSUInteger)queueDepthForPriority:(LGOperationPriority)aPriority;
+
+/**
+ * @return Average interval between enqueuing and sending of aPriority operations
+ */
+- (NSTimeInterval)averageWaitTimeForPriority:(LGOperationPriority)aPriority;
+
+/**
+ * @return Longest interval between enqueuing and sending of aPriority operations
+ */
+- (NSTimeInterval)maxWaitTimeForPriority:(LGOperationPriority)aPriority;
+
+/**
+ * Zeroes wait time statistics
+ */
+- (void)resetStatistics;
+
+#pragma mark - Public Methods -
+
+/**
+ * Enqueues ble-operation
+ * @param aPriority priority class of operation
+ * @param aType type of operation, used for matching response
+ * @param aKey attribute (CBCharacteristic, CBService...) on which operation is made
+ * @param expectsResponse NO for operations without response (e.g. write without response),
+ * such operations are treated as completed right after sending, but count toward write window
+ * @param aBlock block which actually sends operation to peripheral
+ */
+- (void)enqueueOperationWithPriority:(LGOperationPriority)aPriority
+                                type:(LGOperationType)aType
+                                 key:(id)aKey
+                     expectsResponse:(BOOL)expectsResponse
+                               block:(dispatch_block_t)aBlock;
+
+/**
+ * Enqueues ble-operation
+ * @param aFailureCallback will be called instead of response if operation is dropped
+ * (not connected, timed out or canceled), see enqueueOperationWithPriority:type:key:expectsResponse:block:
+ */
+- (void)enqueueOperationWithPriority:(LGOperationPriority)aPriority
+                                type:(LGOperationType)aType
+                                 key:(id)aKey
+                     expectsResponse:(BOOL)expectsResponse
+                               block:(dispatch_block_t)aBlock
+                             failure:(LGOperationSchedulerFailureCallback)aFailureCallback;
+
+/**
+ * Marks oldest in-flight operation of aType on aKey as completed,
+ * does nothing if there is no such operation (e.g. for notifications)
+ */
+- (void)completeOperationWithType:(LGOperationType)aType
+                              key:(id)aKey;
+
+/**
+ * Refills write without response windows and sends waiting operations,
+ * should be called when peripheral is ready to send more writes without response
+ */
+- (void)handleReadyToSendWriteWithoutResponse;
+
+/**
+ * Drops all waiting and in-flight operations (e.g. after disconnect),
+ * their failure callbacks are called with kLGOperationCanceledErrorCode
+ */
+- (void)cancelAllOperations;
+
+@end
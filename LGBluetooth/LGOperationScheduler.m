@@ -0,0 +1,424 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGOperationScheduler.h"
+
+#import "LGUtils.h"
+
+// Count of priority classes
+#define kLGOperationPriorityCount (LGOperationPriorityBulk + 1)
+
+// Error Domains
+NSString * const kLGOperationSchedulerErrorDomain = @"LGOperationSchedulerErrorDomain";
+
+// Error Codes
+const NSInteger kLGOperationTimeoutErrorCode      = 450;
+const NSInteger kLGOperationCanceledErrorCode     = 451;
+const NSInteger kLGOperationNotConnectedErrorCode = 452;
+
+NSString * const kLGOperationTimeoutErrorMessage      = @"BLE Device didn't respond to operation in time";
+NSString * const kLGOperationCanceledErrorMessage     = @"Operation was canceled";
+NSString * const kLGOperationNotConnectedErrorMessage = @"BLE Device is not connected";
+
+/*----------------------------------------------------*/
+#pragma mark - LGScheduledOperation -
+/*----------------------------------------------------*/
+
+@interface LGScheduledOperation : NSObject
+
+@property (assign, nonatomic) LGOperationPriority priority;
+
+@property (assign, nonatomic) LGOperationType type;
+
+@property (strong, nonatomic) id key;
+
+@property (assign, nonatomic) BOOL expectsResponse;
+
+@property (copy, nonatomic) dispatch_block_t block;
+
+@property (copy, nonatomic) LGOperationSchedulerFailureCallback failureBlock;
+
+@property (assign, nonatomic) CFAbsoluteTime enqueueTime;
+
+@end
+
+@implementation LGScheduledOperation
+
+@end
+
+/*----------------------------------------------------*/
+#pragma mark - LGOperationScheduler -
+/*----------------------------------------------------*/
+
+@interface LGOperationScheduler ()
+{
+    NSUInteger     _waitCount[kLGOperationPriorityCount];
+    NSTimeInterval _waitTotal[kLGOperationPriorityCount];
+    NSTimeInterval _waitMax[kLGOperationPriorityCount];
+    NSUInteger     _writesWithoutResponse[kLGOperationPriorityCount];
+}
+
+/**
+ * Waiting operations, one array per priority class.
+ * Each priority array contains lanes (arrays of operations with the same key),
+ * lanes are served round-robin
+ */
+@property (strong, nonatomic) NSArray *priorityLanes;
+
+/**
+ * Operations which were sent and wait for response
+ */
+@property (strong, nonatomic) NSMutableArray *inFlightOperations;
+
+/**
+ * Guards against nested dispatching from operation blocks
+ */
+@property (assign, nonatomic, getter = isDispatching) BOOL dispatching;
+
+/**
+ * Indicates if write without response windows will be refilled by timer
+ */
+@property (assign, nonatomic, getter = isRefillScheduled) BOOL refillScheduled;
+
+@end
+
+@implementation LGOperationScheduler
+
+/*----------------------------------------------------*/
+#pragma mark - Getter/Setter -
+/*----------------------------------------------------*/
+
+- (void)setPipeliningDepth:(NSUInteger)pipeliningDepth
+{
+    _pipeliningDepth = MAX(pipeliningDepth, 1);
+    [self dispatchOperations];
+}
+
+- (void)setWriteWithoutResponseWindow:(NSUInteger)writeWithoutResponseWindow
+{
+    _writeWithoutResponseWindow = MAX(writeWithoutResponseWindow, 1);
+    [self dispatchOperations];
+}
+
+- (NSUInteger)queueDepth
+{
+    NSUInteger depth = 0;
+    for (NSInteger priority = 0; priority < kLGOperationPriorityCount; priority++) {
+        depth += [self queueDepthForPriority:priority];
+    }
+    return depth;
+}
+
+- (NSUInteger)inFlightCount
+{
+    return [self.inFlightOperations count];
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Statistics -
+/*----------------------------------------------------*/
+
+- (NSUInteger)queueDepthForPriority:(LGOperationPriority)aPriority
+{
+    NSUInteger depth = 0;
+    for (NSArray *lane in self.priorityLanes[aPriority]) {
+        depth += [lane count];
+    }
+    return depth;
+}
+
+- (NSTimeInterval)averageWaitTimeForPriority:(LGOperationPriority)aPriority
+{
+    return _waitCount[aPriority] ? _waitTotal[aPriority] / _waitCount[aPriority] : 0;
+}
+
+- (NSTimeInterval)maxWaitTimeForPriority:(LGOperationPriority)aPriority
+{
+    return _waitMax[aPriority];
+}
+
+- (void)resetStatistics
+{
+    memset(_waitCount, 0, sizeof(_waitCount));
+    memset(_waitTotal, 0, sizeof(_waitTotal));
+    memset(_waitMax, 0, sizeof(_waitMax));
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Public Methods -
+/*----------------------------------------------------*/
+
+- (void)enqueueOperationWithPriority:(LGOperationPriority)aPriority
+                                type:(LGOperationType)aType
+                                 key:(id)aKey
+                     expectsResponse:(BOOL)expectsResponse
+                               block:(dispatch_block_t)aBlock
+{
+    [self enqueueOperationWithPriority:aPriority
+                                  type:aType
+                                   key:aKey
+                       expectsResponse:expectsResponse
+                                 block:aBlock
+                               failure:nil];
+}
+
+- (void)enqueueOperationWithPriority:(LGOperationPriority)aPriority
+                                type:(LGOperationType)aType
+                                 key:(id)aKey
+                     expectsResponse:(BOOL)expectsResponse
+                               block:(dispatch_block_t)aBlock
+                             failure:(LGOperationSchedulerFailureCallback)aFailureCallback
+{
+    if (![self isConnected]) {
+        // CoreBluetooth ignores such operations, response would never come
+        if (aFailureCallback) {
+            aFailureCallback([self errorWithCode:kLGOperationNotConnectedErrorCode
+                                         message:kLGOperationNotConnectedErrorMessage]);
+        }
+        return;
+    }
+    LGScheduledOperation *operation = [LGScheduledOperation new];
+    operation.priority        = MIN(MAX(aPriority, 0), kLGOperationPriorityCount - 1);
+    operation.type            = aType;
+    operation.key             = aKey;
+    operation.expectsResponse = expectsResponse;
+    operation.block           = aBlock;
+    operation.failureBlock    = aFailureCallback;
+    operation.enqueueTime     = CFAbsoluteTimeGetCurrent();
+    
+    NSMutableArray *lanes = self.priorityLanes[operation.priority];
+    NSMutableArray *lane = nil;
+    for (NSMutableArray *existing in lanes) {
+        if ([(LGScheduledOperation *)existing[0] key] == aKey) {
+            lane = existing;
+            break;
+        }
+    }
+    if (!lane) {
+        lane = [NSMutableArray new];
+        [lanes addObject:lane];
+    }
+    [lane addObject:operation];
+    
+    [self dispatchOperations];
+}
+
+- (void)completeOperationWithType:(LGOperationType)aType
+                              key:(id)aKey
+{
+    for (NSUInteger i = 0; i < [self.inFlightOperations count]; i++) {
+        LGScheduledOperation *operation = self.inFlightOperations[i];
+        if (operation.type == aType && operation.key == aKey) {
+            [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                                     selector:@selector(operationTimedOut:)
+                                                       object:operation];
+            [self.inFlightOperations removeObjectAtIndex:i];
+            [self dispatchOperations];
+            return;
+        }
+    }
+}
+
+- (void)handleReadyToSendWriteWithoutResponse
+{
+    [NSObject cancelPreviousPerformRequestsWithTarget:self
+                                             selector:@selector(refillWriteWithoutResponseWindows)
+                                               object:nil];
+    [self refillWriteWithoutResponseWindows];
+}
+
+- (void)cancelAllOperations
+{
+    LGLog(@"Canceling %lu waiting and %lu in-flight operations",
+          (unsigned long)self.queueDepth, (unsigned long)self.inFlightCount);
+    NSMutableArray *canceled = [NSMutableArray arrayWithArray:self.inFlightOperations];
+    for (NSMutableArray *lanes in self.priorityLanes) {
+        for (NSArray *lane in lanes) {
+            [canceled addObjectsFromArray:lane];
+        }
+        [lanes removeAllObjects];
+    }
+    [self.inFlightOperations removeAllObjects];
+    // Timeouts and windows refill
+    [NSObject cancelPreviousPerformRequestsWithTarget:self];
+    self.refillScheduled = NO;
+    memset(_writesWithoutResponse, 0, sizeof(_writesWithoutResponse));
+    
+    // Scheduler is already clean, so callbacks can enqueue new operations
+    NSError *error = [self errorWithCode:kLGOperationCanceledErrorCode
+                                 message:kLGOperationCanceledErrorMessage];
+    for (LGScheduledOperation *operation in canceled) {
+        if (operation.failureBlock) {
+            operation.failureBlock(error);
+        }
+    }
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Private Methods -
+/*----------------------------------------------------*/
+
+- (BOOL)isConnected
+{
+    return !self.connectionReadinessBlock || self.connectionReadinessBlock();
+}
+
+- (NSError *)errorWithCode:(NSInteger)aCode message:(NSString *)aMsg
+{
+    return [NSError errorWithDomain:kLGOperationSchedulerErrorDomain
+                               code:aCode
+                           userInfo:@{kLGErrorMessageKey : aMsg}];
+}
+
+/**
+ * @return YES if anOperation fits into pipelining depth (operations with response)
+ * or into write window of its priority class (operations without response)
+ */
+- (BOOL)canSendOperation:(LGScheduledOperation *)anOperation
+{
+    if (anOperation.expectsResponse) {
+        return [self.inFlightOperations count] < self.pipeliningDepth;
+    }
+    if (_writesWithoutResponse[anOperation.priority] >= self.writeWithoutResponseWindow) {
+        return NO;
+    }
+    return !self.writeWithoutResponseReadinessBlock || self.writeWithoutResponseReadinessBlock();
+}
+
+/**
+ * Takes operation from the first sendable lane of highest non-empty priority class,
+ * and moves that lane to the end, so other attributes are served next.
+ * Lower classes aren't served while higher one has waiting operations,
+ * so they can't fill peripheral's queues in front of them
+ */
+- (LGScheduledOperation *)dequeueOperation
+{
+    if (![self isConnected]) {
+        return nil;
+    }
+    for (NSMutableArray *lanes in self.priorityLanes) {
+        if (![lanes count]) {
+            continue;
+        }
+        for (NSUInteger i = 0; i < [lanes count]; i++) {
+            NSMutableArray *lane = lanes[i];
+            LGScheduledOperation *operation = lane[0];
+            if (![self canSendOperation:operation]) {
+                continue;
+            }
+            [lane removeObjectAtIndex:0];
+            [lanes removeObjectAtIndex:i];
+            if ([lane count]) {
+                [lanes addObject:lane];
+            }
+            return operation;
+        }
+        return nil;
+    }
+    return nil;
+}
+
+- (void)dispatchOperations
+{
+    if (self.isDispatching) {
+        return;
+    }
+    self.dispatching = YES;
+    LGScheduledOperation *operation = nil;
+    while ((operation = [self dequeueOperation])) {
+        NSTimeInterval wait = CFAbsoluteTimeGetCurrent() - operation.enqueueTime;
+        _waitCount[operation.priority]++;
+        _waitTotal[operation.priority] += wait;
+        _waitMax[operation.priority] = MAX(_waitMax[operation.priority], wait);
+        
+        if (operation.expectsResponse) {
+            [self.inFlightOperations addObject:operation];
+            if (self.responseTimeout > 0) {
+                [self performSelector:@selector(operationTimedOut:)
+                           withObject:operation
+                           afterDelay:self.responseTimeout];
+            }
+        } else {
+            _writesWithoutResponse[operation.priority]++;
+            [self scheduleWindowsRefill];
+        }
+        if (operation.block) {
+            operation.block();
+        }
+    }
+    self.dispatching = NO;
+}
+
+- (void)scheduleWindowsRefill
+{
+    if (self.isRefillScheduled) {
+        return;
+    }
+    self.refillScheduled = YES;
+    [self performSelector:@selector(refillWriteWithoutResponseWindows)
+               withObject:nil
+               afterDelay:self.writeWithoutResponseRefillInterval];
+}
+
+- (void)refillWriteWithoutResponseWindows
+{
+    self.refillScheduled = NO;
+    memset(_writesWithoutResponse, 0, sizeof(_writesWithoutResponse));
+    [self dispatchOperations];
+}
+
+- (void)operationTimedOut:(LGScheduledOperation *)anOperation
+{
+    if (![self.inFlightOperations containsObject:anOperation]) {
+        return;
+    }
+    LGLogError(@"Operation of type %ld timed out", (long)anOperation.type);
+    [self.inFlightOperations removeObject:anOperation];
+    if (anOperation.failureBlock) {
+        anOperation.failureBlock([self errorWithCode:kLGOperationTimeoutErrorCode
+                                             message:kLGOperationTimeoutErrorMessage]);
+    }
+    [self dispatchOperations];
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Lifecycle -
+/*----------------------------------------------------*/
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        NSMutableArray *priorityLanes = [NSMutableArray new];
+        for (NSInteger priority = 0; priority < kLGOperationPriorityCount; priority++) {
+            [priorityLanes addObject:[NSMutableArray new]];
+        }
+        _priorityLanes = priorityLanes;
+        _inFlightOperations = [NSMutableArray new];
+        _pipeliningDepth = 1;
+        _writeWithoutResponseWindow = 8;
+        _writeWithoutResponseRefillInterval = 0.01;
+        _responseTimeout = 10;
+    }
+    return self;
+}
+
+@end
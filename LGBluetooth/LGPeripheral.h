@@ -20,8 +20,13 @@
 // IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#import "LGOperationScheduler.h"
+
 @class CBPeripheral;
 @class LGCentralManager;
+@class LGCodecPipeline;
+@class LGCharacteristic;
+@class LGService;
 
 #pragma mark - Notification identifiers -
 
@@ -121,6 +126,11 @@ typedef void(^LGPeripheralRSSIValueCallback)(NSNumber *RSSI, NSError *error);
  */
 @property (assign, nonatomic, readonly) BOOL watchDogRaised;
 
+/**
+ * Scheduler through which all GATT operations of this peripheral are issued
+ */
+@property (strong, nonatomic, readonly) LGOperationScheduler *scheduler;
+
 /**
  * Signal strength of peripheral
  */
@@ -175,6 +185,36 @@ typedef void(^LGPeripheralRSSIValueCallback)(NSNumber *RSSI, NSError *error);
  */
 - (void)readRSSIValueCompletion:(LGPeripheralRSSIValueCallback)aCallback;
 
+/**
+ * Attaches codec pipeline to characteristic, all values written to/read from it
+ * will be passed through the pipeline (also applies to LGUtils read/write methods)
+ * @param aPipeline Pipeline which will be attached, nil to detach
+ * @param aUUIDString NSString representation of Characteristic UUID
+ */
+- (void)setCodecPipeline:(LGCodecPipeline *)aPipeline
+   forCharacteristicUUID:(NSString *)aUUIDString;
+
+/**
+ * @param aUUIDString NSString representation of Characteristic UUID
+ * @return Codec pipeline attached to characteristic, nil if there is no one
+ */
+- (LGCodecPipeline *)codecPipelineForCharacteristicUUID:(NSString *)aUUIDString;
+
+/**
+ * Sets priority class of all operations made on characteristic
+ * (also applies to LGUtils read/write methods)
+ * @param aPriority Priority class of operations
+ * @param aUUIDString NSString representation of Characteristic UUID
+ */
+- (void)setOperationPriority:(LGOperationPriority)aPriority
+       forCharacteristicUUID:(NSString *)aUUIDString;
+
+/**
+ * @param aUUIDString NSString representation of Characteristic UUID
+ * @return Priority class of characteristic operations, LGOperationPriorityDefault if it wasn't set
+ */
+- (LGOperationPriority)operationPriorityForCharacteristicUUID:(NSString *)aUUIDString;
+
 #pragma mark - Private Handlers -
 
 // ----- Used for input events -----/
@@ -183,10 +223,40 @@ typedef void(^LGPeripheralRSSIValueCallback)(NSNumber *RSSI, NSError *error);
 
 - (void)handleDisconnectWithError:(NSError *)anError;
 
+- (void)handleDiscoveredServicesWithError:(NSError *)anError;
+
+- (void)handleReadRSSI:(NSNumber *)RSSI error:(NSError *)anError;
+
+/**
+ * @return Discovered characteristic wrapper found by service and characteristic UUID strings
+ */
+- (LGCharacteristic *)wrapperByServiceUUID:(NSString *)aServiceUUID
+                        characteristicUUID:(NSString *)aCharacteristicUUID;
+
+// ----- Used for replay, wrappers without CBPeripheral only -----/
+
+/**
+ * @return Service wrapper found by UUID string, created over placeholder CBMutableService
+ * if it wasn't seen yet, nil for wrappers over CBPeripheral
+ */
+- (LGService *)replayServiceWithUUID:(NSString *)aServiceUUID;
+
+/**
+ * @return Characteristic wrapper found by UUID strings, created over placeholder
+ * CBMutableCharacteristic if it wasn't seen yet, nil for wrappers over CBPeripheral
+ */
+- (LGCharacteristic *)replayCharacteristicWithUUID:(NSString *)aCharacteristicUUID
+                                       serviceUUID:(NSString *)aServiceUUID;
+
 #pragma mark - Private Initializer -
 /**
  * @return Wrapper object over Core Bluetooth's CBPeripheral
  */
 - (instancetype)initWithPeripheral:(CBPeripheral *)aPeripheral manager:(LGCentralManager *)manager;
 
+/**
+ * @return Wrapper without CBPeripheral, used for replaying recorded traces
+ */
+- (instancetype)initWithIdentifier:(NSUUID *)anIdentifier manager:(LGCentralManager *)manager;
+
 @end
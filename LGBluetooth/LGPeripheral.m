@@ -28,6 +28,7 @@
 #import <IOBluetooth/IOBluetooth.h>
 #endif
 #import "LGCentralManager.h"
+#import "LGTraceRecorder.h"
 #import "LGUtils.h"
 
 // Notifications
@@ -55,6 +56,21 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
 
 @property (readonly, nonatomic, getter = isConnected) BOOL connected;
 
+/**
+ * Codec pipelines by lowercased characteristic UUID strings
+ */
+@property (strong, nonatomic) NSMutableDictionary *codecPipelines;
+
+/**
+ * Operation priorities by lowercased characteristic UUID strings
+ */
+@property (strong, nonatomic) NSMutableDictionary *operationPriorities;
+
+/**
+ * Identifier of wrapper without CBPeripheral (replayed from trace)
+ */
+@property (strong, nonatomic) NSUUID *identifier;
+
 @end
 
 @implementation LGPeripheral
@@ -70,12 +86,12 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
 
 - (NSString *)UUIDString
 {
-    return [self.cbPeripheral.identifier UUIDString];
+    return [(self.cbPeripheral.identifier ? : self.identifier) UUIDString];
 }
 
 - (NSString *)name
 {
-    return [self.cbPeripheral name];
+    return self.cbPeripheral ? [self.cbPeripheral name] : self.advertisingData[CBAdvertisementDataLocalNameKey];
 }
 
 
@@ -130,7 +146,20 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
     self.discoverServicesBlock = aCallback;
     if (self.isConnected) {
         _discoveringServices = YES;
-        [self.cbPeripheral discoverServices:serviceUUIDs];
+        [self.scheduler enqueueOperationWithPriority:LGOperationPriorityDefault
+                                                type:LGOperationTypeDiscoverServices
+                                                 key:self.cbPeripheral
+                                     expectsResponse:YES
+                                               block:^{
+                                                   [self.cbPeripheral discoverServices:serviceUUIDs];
+                                               }
+                                             failure:^(NSError *error) {
+                                                 self->_discoveringServices = NO;
+                                                 if (self.discoverServicesBlock) {
+                                                     self.discoverServicesBlock(nil, error);
+                                                 }
+                                                 self.discoverServicesBlock = nil;
+                                             }];
     } else if (self.discoverServicesBlock) {
         self.discoverServicesBlock(nil, [self connectionErrorWithCode:kConnectionMissingErrorCode
                                                               message:kConnectionMissingErrorMessage]);
@@ -142,7 +171,16 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
 {
     self.rssiValueBlock = aCallback;
     if (self.isConnected) {
-        [self.cbPeripheral readRSSI];
+        [self.scheduler enqueueOperationWithPriority:LGOperationPriorityDefault
+                                                type:LGOperationTypeReadRSSI
+                                                 key:self.cbPeripheral
+                                     expectsResponse:YES
+                                               block:^{
+                                                   [self.cbPeripheral readRSSI];
+                                               }
+                                             failure:^(NSError *error) {
+                                                 [self handleReadRSSI:nil error:error];
+                                             }];
     } else if (self.rssiValueBlock) {
         self.rssiValueBlock(nil, [self connectionErrorWithCode:kConnectionMissingErrorCode
                                                        message:kConnectionMissingErrorMessage]);
@@ -150,6 +188,51 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
     }
 }
 
+- (void)setCodecPipeline:(LGCodecPipeline *)aPipeline
+   forCharacteristicUUID:(NSString *)aUUIDString
+{
+    NSString *key = [aUUIDString lowercaseString];
+    if (aPipeline) {
+        self.codecPipelines[key] = aPipeline;
+    } else {
+        [self.codecPipelines removeObjectForKey:key];
+    }
+    // Updating already discovered characteristics
+    for (LGService *service in self.services) {
+        for (LGCharacteristic *characteristic in service.characteristics) {
+            if ([[characteristic.UUIDString lowercaseString] isEqualToString:key]) {
+                characteristic.codecPipeline = aPipeline;
+            }
+        }
+    }
+}
+
+- (LGCodecPipeline *)codecPipelineForCharacteristicUUID:(NSString *)aUUIDString
+{
+    return self.codecPipelines[[aUUIDString lowercaseString]];
+}
+
+- (void)setOperationPriority:(LGOperationPriority)aPriority
+       forCharacteristicUUID:(NSString *)aUUIDString
+{
+    NSString *key = [aUUIDString lowercaseString];
+    self.operationPriorities[key] = @(aPriority);
+    // Updating already discovered characteristics
+    for (LGService *service in self.services) {
+        for (LGCharacteristic *characteristic in service.characteristics) {
+            if ([[characteristic.UUIDString lowercaseString] isEqualToString:key]) {
+                characteristic.operationPriority = aPriority;
+            }
+        }
+    }
+}
+
+- (LGOperationPriority)operationPriorityForCharacteristicUUID:(NSString *)aUUIDString
+{
+    NSNumber *priority = self.operationPriorities[[aUUIDString lowercaseString]];
+    return priority ? [priority integerValue] : LGOperationPriorityDefault;
+}
+
 /*----------------------------------------------------*/
 #pragma mark - Handler Methods -
 /*----------------------------------------------------*/
@@ -161,6 +244,8 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
                                              selector:@selector(connectionWatchDogFired)
                                                object:nil];
     LGLog(@"Connection with error - %@", anError);
+    // Nothing from previous connection can be answered
+    [self.scheduler cancelAllOperations];
     if (self.connectionBlock) {
         self.connectionBlock(anError);
     }
@@ -173,6 +258,9 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
 - (void)handleDisconnectWithError:(NSError *)anError
 {
     LGLog(@"Disconnect with error - %@", anError);
+    // Responses for sent operations will never come
+    [self.scheduler cancelAllOperations];
+    [self resetCodecPipelines];
     if (self.disconnectBlock) {
         self.disconnectBlock(anError);
     } else {
@@ -183,6 +271,31 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
     self.disconnectBlock = nil;
 }
 
+- (void)handleDiscoveredServicesWithError:(NSError *)anError
+{
+    _discoveringServices = NO;
+    [self updateServiceWrappers];
+
+#if LG_ENABLE_BLE_LOGGING != 0
+    for (LGService *aService in self.services) {
+        LGLog(@"Service discovered - %@", aService.cbService.UUID);
+    }
+#endif
+    
+    if (self.discoverServicesBlock) {
+        self.discoverServicesBlock(self.services, anError);
+    }
+    self.discoverServicesBlock = nil;
+}
+
+- (void)handleReadRSSI:(NSNumber *)RSSI error:(NSError *)anError
+{
+    if (self.rssiValueBlock) {
+        self.rssiValueBlock(RSSI, anError);
+    }
+    self.rssiValueBlock = nil;
+}
+
 /*----------------------------------------------------*/
 #pragma mark - Error Generators -
 /*----------------------------------------------------*/
@@ -213,8 +326,29 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
     }];
 }
 
+/**
+ * Resets codecs of all attached pipelines, as peer may have missed
+ * dropped or unacknowledged payloads
+ */
+- (void)resetCodecPipelines
+{
+    NSMutableSet *pipelines = [NSMutableSet setWithArray:[self.codecPipelines allValues]];
+    for (LGService *service in self.services) {
+        for (LGCharacteristic *characteristic in service.characteristics) {
+            if (characteristic.codecPipeline) {
+                [pipelines addObject:characteristic.codecPipeline];
+            }
+        }
+    }
+    [pipelines makeObjectsPerformSelector:@selector(reset)];
+}
+
 - (void)updateServiceWrappers
 {
+    if (!self.cbPeripheral) {
+        // Replayed wrapper, services are created from trace by replayServiceWithUUID:
+        return;
+    }
     NSMutableArray *updatedServices = [NSMutableArray new];
     for (CBService *service in self.cbPeripheral.services) {
         LGService *lgService = [[LGService alloc] initWithService:service];
@@ -237,33 +371,100 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
     return wrapper;
 }
 
+- (LGCharacteristic *)wrapperByServiceUUID:(NSString *)aServiceUUID
+                        characteristicUUID:(NSString *)aCharacteristicUUID
+{
+    for (LGService *service in self.services) {
+        if ([service.UUIDString caseInsensitiveCompare:aServiceUUID] != NSOrderedSame) {
+            continue;
+        }
+        for (LGCharacteristic *characteristic in service.characteristics) {
+            if ([characteristic.UUIDString caseInsensitiveCompare:aCharacteristicUUID] == NSOrderedSame) {
+                return characteristic;
+            }
+        }
+    }
+    return nil;
+}
+
+- (LGService *)replayServiceWithUUID:(NSString *)aServiceUUID
+{
+    if (self.cbPeripheral || ![aServiceUUID length]) {
+        return nil;
+    }
+    for (LGService *service in self.services) {
+        if ([service.UUIDString caseInsensitiveCompare:aServiceUUID] == NSOrderedSame) {
+            return service;
+        }
+    }
+    CBMutableService *cbService = [[CBMutableService alloc] initWithType:[CBUUID UUIDWithString:aServiceUUID]
+                                                                 primary:YES];
+    LGService *service = [[LGService alloc] initWithService:cbService];
+    _services = [(self.services ? : @[]) arrayByAddingObject:service];
+    return service;
+}
+
+- (LGCharacteristic *)replayCharacteristicWithUUID:(NSString *)aCharacteristicUUID
+                                       serviceUUID:(NSString *)aServiceUUID
+{
+    LGService *service = [self replayServiceWithUUID:aServiceUUID];
+    if (!service || ![aCharacteristicUUID length]) {
+        return nil;
+    }
+    for (LGCharacteristic *characteristic in service.characteristics) {
+        if ([characteristic.UUIDString caseInsensitiveCompare:aCharacteristicUUID] == NSOrderedSame) {
+            return characteristic;
+        }
+    }
+    CBMutableCharacteristic *cbCharacteristic =
+    [[CBMutableCharacteristic alloc] initWithType:[CBUUID UUIDWithString:aCharacteristicUUID]
+                                       properties:CBCharacteristicPropertyRead | CBCharacteristicPropertyWrite | CBCharacteristicPropertyNotify
+                                            value:nil
+                                      permissions:CBAttributePermissionsReadable | CBAttributePermissionsWriteable];
+    LGCharacteristic *characteristic = [[LGCharacteristic alloc] initWithCharacteristic:cbCharacteristic];
+    characteristic.codecPipeline = [self codecPipelineForCharacteristicUUID:aCharacteristicUUID];
+    characteristic.operationPriority = [self operationPriorityForCharacteristicUUID:aCharacteristicUUID];
+    service.characteristics = [(service.characteristics ? : @[]) arrayByAddingObject:characteristic];
+    return characteristic;
+}
+
+- (void)recordEventOfType:(LGTraceEventType)aType
+                  service:(CBUUID *)aService
+           characteristic:(CBUUID *)aCharacteristic
+                    value:(NSInteger)aValue
+                  payload:(NSData *)aPayload
+                    error:(NSError *)anError
+{
+    [self.manager.traceRecorder recordEventOfType:aType
+                                       peripheral:self.cbPeripheral.identifier
+                                          service:aService
+                                   characteristic:aCharacteristic
+                                            value:aValue
+                                          payload:aPayload
+                                            error:anError];
+}
+
 /*----------------------------------------------------*/
 #pragma mark - CBPeripheral Delegate -
 /*----------------------------------------------------*/
 
 - (void)peripheral:(CBPeripheral *)peripheral didDiscoverServices:(NSError *)error
 {
+    [self recordEventOfType:LGTraceEventTypeDiscoverServices service:nil characteristic:nil
+                      value:0 payload:nil error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
-        _discoveringServices = NO;
-        [self updateServiceWrappers];
-
-#if LG_ENABLE_BLE_LOGGING != 0
-        for (LGService *aService in self.services) {
-            LGLog(@"Service discovered - %@", aService.cbService.UUID);
-        }
-#endif
-        
-        if (self.discoverServicesBlock) {
-            self.discoverServicesBlock(self.services, error);
-        }
-        self.discoverServicesBlock = nil;
+        [self.scheduler completeOperationWithType:LGOperationTypeDiscoverServices key:peripheral];
+        [self handleDiscoveredServicesWithError:error];
     });
 }
 
 - (void)peripheral:(CBPeripheral *)peripheral didDiscoverCharacteristicsForService:(CBService *)service
              error:(NSError *)error
 {
+    [self recordEventOfType:LGTraceEventTypeDiscoverCharacteristics service:service.UUID characteristic:nil
+                      value:0 payload:nil error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
+        [self.scheduler completeOperationWithType:LGOperationTypeDiscoverCharacteristics key:service];
         [[self wrapperByService:service] handleDiscoveredCharacteristics:service.characteristics
                                                                    error:error];
     });
@@ -273,7 +474,12 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
              error:(NSError *)error
 {
     NSData *value = [characteristic.value copy];
+    [self recordEventOfType:LGTraceEventTypeUpdateValue service:characteristic.service.UUID
+             characteristic:characteristic.UUID value:0 payload:value error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
+        // Notifications come through here too and can't be told apart from read response,
+        // so any update completes in-flight read (if there is one), whatever notifying state is
+        [self.scheduler completeOperationWithType:LGOperationTypeRead key:characteristic];
         [[[self wrapperByService:characteristic.service]
           wrapperByCharacteristic:characteristic]
          handleReadValue:value error:error];
@@ -283,7 +489,10 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
 - (void)peripheral:(CBPeripheral *)peripheral didUpdateNotificationStateForCharacteristic:(CBCharacteristic *)characteristic
              error:(NSError *)error
 {
+    [self recordEventOfType:LGTraceEventTypeUpdateNotificationState service:characteristic.service.UUID
+             characteristic:characteristic.UUID value:characteristic.isNotifying payload:nil error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
+        [self.scheduler completeOperationWithType:LGOperationTypeNotify key:characteristic];
         [[[self wrapperByService:characteristic.service]
           wrapperByCharacteristic:characteristic]
          handleSetNotifiedWithError:error];
@@ -293,20 +502,32 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
 - (void)peripheral:(CBPeripheral *)peripheral didWriteValueForCharacteristic:(CBCharacteristic *)characteristic
              error:(NSError *)error
 {
+    [self recordEventOfType:LGTraceEventTypeWriteValue service:characteristic.service.UUID
+             characteristic:characteristic.UUID value:0 payload:nil error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
+        [self.scheduler completeOperationWithType:LGOperationTypeWrite key:characteristic];
         [[[self wrapperByService:characteristic.service]
           wrapperByCharacteristic:characteristic]
          handleWrittenValueWithError:error];
     });
 }
 
+- (void)peripheralIsReadyToSendWriteWithoutResponse:(CBPeripheral *)peripheral
+{
+    [self recordEventOfType:LGTraceEventTypeReadyToSendWriteWithoutResponse service:nil characteristic:nil
+                      value:0 payload:nil error:nil];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self.scheduler handleReadyToSendWriteWithoutResponse];
+    });
+}
+
 - (void)peripheral:(CBPeripheral *)peripheral didReadRSSI:(NSNumber *)RSSI error:(NSError *)error
 {
+    [self recordEventOfType:LGTraceEventTypeReadRSSI service:nil characteristic:nil
+                      value:[RSSI integerValue] payload:nil error:error];
     dispatch_async(dispatch_get_main_queue(), ^{
-        if (self.rssiValueBlock) {
-            self.rssiValueBlock(RSSI, error);
-        }
-        self.rssiValueBlock = nil;
+        [self.scheduler completeOperationWithType:LGOperationTypeReadRSSI key:peripheral];
+        [self handleReadRSSI:RSSI error:error];
     });
 }
 
@@ -323,6 +544,33 @@ NSString * const kConnectionMissingErrorMessage = @"BLE Device is not connected"
         _cbPeripheral = aPeripheral;
         _cbPeripheral.delegate = self;
         _manager = manager;
+        _codecPipelines = [NSMutableDictionary new];
+        _operationPriorities = [NSMutableDictionary new];
+        _scheduler = [LGOperationScheduler new];
+        __weak CBPeripheral *weakPeripheral = aPeripheral;
+        _scheduler.connectionReadinessBlock = ^BOOL{
+            return weakPeripheral.state == CBPeripheralStateConnected;
+        };
+        if ([aPeripheral respondsToSelector:@selector(canSendWriteWithoutResponse)]) {
+            _scheduler.writeWithoutResponseReadinessBlock = ^BOOL{
+                return weakPeripheral.canSendWriteWithoutResponse;
+            };
+        }
+    }
+    return self;
+}
+
+- (instancetype)initWithIdentifier:(NSUUID *)anIdentifier manager:(LGCentralManager *)manager
+{
+    if (!anIdentifier) {
+        return nil;
+    }
+    if (self = [super init]) {
+        _identifier = anIdentifier;
+        _manager = manager;
+        _codecPipelines = [NSMutableDictionary new];
+        _operationPriorities = [NSMutableDictionary new];
+        _scheduler = [LGOperationScheduler new];
     }
     return self;
 }
@@ -29,6 +29,7 @@
 #import <IOBluetooth/IOBluetooth.h>
 #endif
 #import "LGCharacteristic.h"
+#import "LGPeripheral.h"
 #import "LGUtils.h"
 
 @interface LGService ()
@@ -63,8 +64,27 @@
 {
     self.discoverCharBlock = aCallback;
     _discoveringCharacteristics = YES;
-    [self.cbService.peripheral discoverCharacteristics:uuids
-                                            forService:self.cbService];
+    dispatch_block_t discover = ^{
+        [self.cbService.peripheral discoverCharacteristics:uuids
+                                                forService:self.cbService];
+    };
+    LGPeripheral *peripheral = [self peripheral];
+    if (peripheral) {
+        [peripheral.scheduler enqueueOperationWithPriority:LGOperationPriorityDefault
+                                                      type:LGOperationTypeDiscoverCharacteristics
+                                                       key:self.cbService
+                                           expectsResponse:YES
+                                                     block:discover
+                                                   failure:^(NSError *error) {
+                                                       self->_discoveringCharacteristics = NO;
+                                                       if (self.discoverCharBlock) {
+                                                           self.discoverCharBlock(nil, error);
+                                                       }
+                                                       self.discoverCharBlock = nil;
+                                                   }];
+    } else {
+        discover();
+    }
 }
 
 - (LGCharacteristic *)wrapperByCharacteristic:(CBCharacteristic *)aChar
@@ -83,12 +103,30 @@
 #pragma mark - Private Methods -
 /*----------------------------------------------------*/
 
+/**
+ * @return LGPeripheral wrapper which owns this service, nil if there is no one
+ */
+- (LGPeripheral *)peripheral
+{
+    id delegate = self.cbService.peripheral.delegate;
+    return [delegate isKindOfClass:[LGPeripheral class]] ? delegate : nil;
+}
+
 - (void)updateCharacteristicWrappers
 {
+    if ([self.cbService isKindOfClass:[CBMutableService class]]) {
+        // Placeholder of replayed trace, characteristics are created by LGPeripheral
+        return;
+    }
+    LGPeripheral *peripheral = [self peripheral];
     NSMutableArray *updatedCharacteristics = [NSMutableArray new];
     for (CBCharacteristic *characteristic in self.cbService.characteristics) {
         LGCharacteristic *lgCharacteristic = [[LGCharacteristic alloc] initWithCharacteristic:characteristic];
         if (lgCharacteristic) {
+            lgCharacteristic.codecPipeline = [peripheral codecPipelineForCharacteristicUUID:lgCharacteristic.UUIDString];
+            if (peripheral) {
+                lgCharacteristic.operationPriority = [peripheral operationPriorityForCharacteristicUUID:lgCharacteristic.UUIDString];
+            }
             [updatedCharacteristics addObject:lgCharacteristic];
         }
     }
@@ -0,0 +1,178 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+@class CBUUID;
+
+/**
+ * Types of recorded CoreBluetooth delegate events
+ */
+typedef NS_ENUM(uint8_t, LGTraceEventType) {
+    LGTraceEventTypeUpdateState = 1,
+    LGTraceEventTypeDiscoverPeripheral,
+    LGTraceEventTypeConnect,
+    LGTraceEventTypeFailToConnect,
+    LGTraceEventTypeDisconnect,
+    LGTraceEventTypeDiscoverServices,
+    LGTraceEventTypeDiscoverCharacteristics,
+    LGTraceEventTypeUpdateValue,
+    LGTraceEventTypeWriteValue,
+    LGTraceEventTypeUpdateNotificationState,
+    LGTraceEventTypeReadRSSI,
+    LGTraceEventTypeReadyToSendWriteWithoutResponse,
+};
+
+/**
+ * Magic and version which start every trace file
+ */
+extern const char kLGTraceMagic[4];
+
+extern const uint32_t kLGTraceVersion;
+
+#pragma mark - LGTraceEvent -
+
+/**
+ * Single recorded delegate event.
+ * Trace file starts with "LGTR" magic and 4 byte version, followed by records :
+ * type (1 byte), timestamp in microseconds (8 bytes), body length (4 bytes), body.
+ * Body : peripheral identifier (16 bytes), value (4 bytes),
+ * service UUID, characteristic UUID, text (1 byte length + UTF8 each),
+ * payload (4 byte length + bytes). All integers are little endian.
+ * Payload of discovery event holds advertisement dictionary as keyed fields
+ */
+@interface LGTraceEvent : NSObject
+
+@property (assign, nonatomic) LGTraceEventType type;
+
+/**
+ * Interval since recording was started
+ */
+@property (assign, nonatomic) NSTimeInterval timestamp;
+
+@property (strong, nonatomic) NSUUID *peripheralIdentifier;
+
+/**
+ * RSSI for discovery/RSSI events, central state for state event,
+ * error code for other events
+ */
+@property (assign, nonatomic) NSInteger value;
+
+/**
+ * Service UUID string
+ */
+@property (copy, nonatomic) NSString *serviceUUID;
+
+@property (copy, nonatomic) NSString *characteristicUUID;
+
+/**
+ * Error domain
+ */
+@property (copy, nonatomic) NSString *text;
+
+/**
+ * Characteristic value
+ */
+@property (strong, nonatomic) NSData *payload;
+
+/**
+ * Advertisement dictionary of discovery event
+ */
+@property (copy, nonatomic) NSDictionary *advertisementData;
+
+/**
+ * @return Error reconstructed from value/text, nil if event had no error
+ */
+- (NSError *)error;
+
+/**
+ * Appends serialized record to aData
+ */
+- (void)appendToData:(NSMutableData *)aData;
+
+/**
+ * Parses record at anOffset, and moves anOffset after it
+ * @return Parsed event, nil at the end of data or if record is malformed
+ */
++ (instancetype)eventFromData:(NSData *)aData offset:(NSUInteger *)anOffset;
+
+@end
+
+#pragma mark - LGTraceRecorder -
+
+/**
+ * Append-only binary recorder of CoreBluetooth delegate events.
+ * Recording methods only capture timestamp and arguments,
+ * serialization and file writes happen on recorder's serial queue
+ */
+@interface LGTraceRecorder : NSObject
+
+/**
+ * Path of trace file
+ */
+@property (copy, nonatomic, readonly) NSString *path;
+
+/**
+ * Count of events which were recorded
+ */
+@property (assign, atomic, readonly) NSUInteger eventsCount;
+
+/**
+ * YES if trace file couldn't be written, recording is stopped then
+ */
+@property (assign, atomic, readonly, getter = isFailed) BOOL failed;
+
+/**
+ * Records discovery of peripheral
+ */
+- (void)recordDiscoveryOfPeripheral:(NSUUID *)anIdentifier
+                  advertisementData:(NSDictionary *)advertisementData
+                               RSSI:(NSNumber *)RSSI;
+
+/**
+ * Records delegate event
+ * @param aType type of event
+ * @param anIdentifier identifier of peripheral, nil for central events
+ * @param aService UUID of service, nil if event isn't related to service
+ * @param aCharacteristic UUID of characteristic, nil if event isn't related to characteristic
+ * @param aValue RSSI/state value, ignored when anError is given
+ * @param aPayload characteristic value
+ * @param anError error which was delivered with event
+ */
+- (void)recordEventOfType:(LGTraceEventType)aType
+               peripheral:(NSUUID *)anIdentifier
+                  service:(CBUUID *)aService
+           characteristic:(CBUUID *)aCharacteristic
+                    value:(NSInteger)aValue
+                  payload:(NSData *)aPayload
+                    error:(NSError *)anError;
+
+/**
+ * Flushes buffered events and closes trace file, further events are ignored
+ */
+- (void)close;
+
+/**
+ * @param aPath Path of trace file, existing file will be overwritten
+ * @return Recorder, nil if file can't be opened
+ */
+- (instancetype)initWithPath:(NSString *)aPath;
+
+@end
@@ -0,0 +1,514 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGTraceRecorder.h"
+
+#if TARGET_OS_IPHONE
+#import <CoreBluetooth/CoreBluetooth.h>
+#elif TARGET_OS_MAC
+#import <IOBluetooth/IOBluetooth.h>
+#endif
+#import "CBUUID+StringExtraction.h"
+#import "LGUtils.h"
+
+const char kLGTraceMagic[4] = {'L', 'G', 'T', 'R'};
+
+const uint32_t kLGTraceVersion = 2;
+
+/**
+ * Size of buffered records after which they are written to file
+ */
+static const NSUInteger kLGTraceFlushThreshold = 64 * 1024;
+
+// Record header : type + timestamp + body length
+static const NSUInteger kLGTraceRecordHeaderLength = 1 + 8 + 4;
+
+/**
+ * Keys of advertisement fields in payload of discovery event
+ */
+typedef NS_ENUM(uint8_t, LGTraceAdvertisementField) {
+    LGTraceAdvertisementFieldLocalName = 1,
+    LGTraceAdvertisementFieldManufacturerData,
+    LGTraceAdvertisementFieldServiceUUIDs,
+    LGTraceAdvertisementFieldServiceData,
+    LGTraceAdvertisementFieldTxPowerLevel,
+    LGTraceAdvertisementFieldIsConnectable,
+    LGTraceAdvertisementFieldOverflowServiceUUIDs,
+    LGTraceAdvertisementFieldSolicitedServiceUUIDs,
+};
+
+/*----------------------------------------------------*/
+#pragma mark - Serialization helpers -
+/*----------------------------------------------------*/
+
+static void LGTraceAppendUInt32(NSMutableData *aData, uint32_t aValue)
+{
+    uint32_t value = CFSwapInt32HostToLittle(aValue);
+    [aData appendBytes:&value length:sizeof(value)];
+}
+
+static void LGTraceAppendUInt64(NSMutableData *aData, uint64_t aValue)
+{
+    uint64_t value = CFSwapInt64HostToLittle(aValue);
+    [aData appendBytes:&value length:sizeof(value)];
+}
+
+static void LGTraceAppendString(NSMutableData *aData, NSString *aString)
+{
+    NSData *utf8 = [aString dataUsingEncoding:NSUTF8StringEncoding];
+    uint8_t length = (uint8_t)MIN([utf8 length], UINT8_MAX);
+    [aData appendBytes:&length length:1];
+    [aData appendBytes:[utf8 bytes] length:length];
+}
+
+static void LGTraceAppendField(NSMutableData *aData, LGTraceAdvertisementField aField, NSData *aValue)
+{
+    if (!aValue) {
+        return;
+    }
+    uint8_t field = aField;
+    [aData appendBytes:&field length:1];
+    LGTraceAppendUInt32(aData, (uint32_t)[aValue length]);
+    [aData appendData:aValue];
+}
+
+static NSData *LGTraceUUIDsData(NSArray *anUUIDs)
+{
+    if (!anUUIDs) {
+        return nil;
+    }
+    NSMutableData *data = [NSMutableData new];
+    for (CBUUID *uuid in anUUIDs) {
+        LGTraceAppendString(data, [uuid representativeString]);
+    }
+    return data;
+}
+
+static NSData *LGTraceNumberData(NSNumber *aNumber)
+{
+    if (!aNumber) {
+        return nil;
+    }
+    NSMutableData *data = [NSMutableData new];
+    LGTraceAppendUInt32(data, (uint32_t)[aNumber intValue]);
+    return data;
+}
+
+static BOOL LGTraceReadBytes(const uint8_t **ip, const uint8_t *ipEnd, void *aBuffer, size_t aLength)
+{
+    if ((size_t)(ipEnd - *ip) < aLength) {
+        return NO;
+    }
+    memcpy(aBuffer, *ip, aLength);
+    *ip += aLength;
+    return YES;
+}
+
+static BOOL LGTraceReadString(const uint8_t **ip, const uint8_t *ipEnd, NSString **aString)
+{
+    uint8_t length;
+    if (!LGTraceReadBytes(ip, ipEnd, &length, 1) || (size_t)(ipEnd - *ip) < length) {
+        return NO;
+    }
+    *aString = length ? [[NSString alloc] initWithBytes:*ip length:length encoding:NSUTF8StringEncoding] : nil;
+    *ip += length;
+    return YES;
+}
+
+static NSArray *LGTraceReadUUIDs(const uint8_t *ip, const uint8_t *ipEnd)
+{
+    NSMutableArray *uuids = [NSMutableArray new];
+    NSString *uuid = nil;
+    while (ip < ipEnd && LGTraceReadString(&ip, ipEnd, &uuid)) {
+        if (uuid) {
+            [uuids addObject:[CBUUID UUIDWithString:uuid]];
+        }
+    }
+    return uuids;
+}
+
+static NSNumber *LGTraceReadNumber(const uint8_t *ip, const uint8_t *ipEnd)
+{
+    uint32_t value;
+    if (!LGTraceReadBytes(&ip, ipEnd, &value, sizeof(value))) {
+        return nil;
+    }
+    return @((int32_t)CFSwapInt32LittleToHost(value));
+}
+
+/**
+ * Serializes advertisement dictionary as keyed fields :
+ * key (1 byte), value length (4 bytes), value.
+ * UUID lists are sequences of strings, service data is sequence of
+ * UUID string + 4 byte length + data, numbers are 4 byte integers
+ */
+static NSData *LGTraceAdvertisementPayload(NSDictionary *advertisementData)
+{
+    NSMutableData *payload = [NSMutableData new];
+    LGTraceAppendField(payload, LGTraceAdvertisementFieldLocalName,
+                       [advertisementData[CBAdvertisementDataLocalNameKey] dataUsingEncoding:NSUTF8StringEncoding]);
+    LGTraceAppendField(payload, LGTraceAdvertisementFieldManufacturerData,
+                       advertisementData[CBAdvertisementDataManufacturerDataKey]);
+    LGTraceAppendField(payload, LGTraceAdvertisementFieldServiceUUIDs,
+                       LGTraceUUIDsData(advertisementData[CBAdvertisementDataServiceUUIDsKey]));
+    NSDictionary *serviceData = advertisementData[CBAdvertisementDataServiceDataKey];
+    if (serviceData) {
+        NSMutableData *data = [NSMutableData new];
+        for (CBUUID *uuid in serviceData) {
+            LGTraceAppendString(data, [uuid representativeString]);
+            LGTraceAppendUInt32(data, (uint32_t)[serviceData[uuid] length]);
+            [data appendData:serviceData[uuid]];
+        }
+        LGTraceAppendField(payload, LGTraceAdvertisementFieldServiceData, data);
+    }
+    LGTraceAppendField(payload, LGTraceAdvertisementFieldTxPowerLevel,
+                       LGTraceNumberData(advertisementData[CBAdvertisementDataTxPowerLevelKey]));
+    LGTraceAppendField(payload, LGTraceAdvertisementFieldIsConnectable,
+                       LGTraceNumberData(advertisementData[CBAdvertisementDataIsConnectable]));
+    LGTraceAppendField(payload, LGTraceAdvertisementFieldOverflowServiceUUIDs,
+                       LGTraceUUIDsData(advertisementData[CBAdvertisementDataOverflowServiceUUIDsKey]));
+    LGTraceAppendField(payload, LGTraceAdvertisementFieldSolicitedServiceUUIDs,
+                       LGTraceUUIDsData(advertisementData[CBAdvertisementDataSolicitedServiceUUIDsKey]));
+    return payload;
+}
+
+/**
+ * Parses keyed fields, unknown and malformed fields are skipped
+ */
+static NSDictionary *LGTraceAdvertisementDataFromPayload(NSData *aPayload)
+{
+    NSMutableDictionary *advertisementData = [NSMutableDictionary new];
+    const uint8_t *ip = [aPayload bytes];
+    const uint8_t *ipEnd = ip + [aPayload length];
+    uint8_t field;
+    uint32_t length;
+    while (LGTraceReadBytes(&ip, ipEnd, &field, sizeof(field)) &&
+           LGTraceReadBytes(&ip, ipEnd, &length, sizeof(length))) {
+        length = CFSwapInt32LittleToHost(length);
+        if ((size_t)(ipEnd - ip) < length) {
+            break;
+        }
+        const uint8_t *fieldEnd = ip + length;
+        NSData *value = [NSData dataWithBytes:ip length:length];
+        switch (field) {
+            case LGTraceAdvertisementFieldLocalName:
+                advertisementData[CBAdvertisementDataLocalNameKey] =
+                [[NSString alloc] initWithData:value encoding:NSUTF8StringEncoding];
+                break;
+            case LGTraceAdvertisementFieldManufacturerData:
+                advertisementData[CBAdvertisementDataManufacturerDataKey] = value;
+                break;
+            case LGTraceAdvertisementFieldServiceUUIDs:
+                advertisementData[CBAdvertisementDataServiceUUIDsKey] = LGTraceReadUUIDs(ip, fieldEnd);
+                break;
+            case LGTraceAdvertisementFieldServiceData: {
+                NSMutableDictionary *serviceData = [NSMutableDictionary new];
+                const uint8_t *dp = ip;
+                NSString *uuid = nil;
+                uint32_t dataLength;
+                while (LGTraceReadString(&dp, fieldEnd, &uuid) &&
+                       LGTraceReadBytes(&dp, fieldEnd, &dataLength, sizeof(dataLength))) {
+                    dataLength = CFSwapInt32LittleToHost(dataLength);
+                    if (!uuid || (size_t)(fieldEnd - dp) < dataLength) {
+                        break;
+                    }
+                    serviceData[[CBUUID UUIDWithString:uuid]] = [NSData dataWithBytes:dp length:dataLength];
+                    dp += dataLength;
+                }
+                advertisementData[CBAdvertisementDataServiceDataKey] = serviceData;
+                break;
+            }
+            case LGTraceAdvertisementFieldTxPowerLevel:
+                advertisementData[CBAdvertisementDataTxPowerLevelKey] = LGTraceReadNumber(ip, fieldEnd);
+                break;
+            case LGTraceAdvertisementFieldIsConnectable:
+                advertisementData[CBAdvertisementDataIsConnectable] = @([LGTraceReadNumber(ip, fieldEnd) boolValue]);
+                break;
+            case LGTraceAdvertisementFieldOverflowServiceUUIDs:
+                advertisementData[CBAdvertisementDataOverflowServiceUUIDsKey] = LGTraceReadUUIDs(ip, fieldEnd);
+                break;
+            case LGTraceAdvertisementFieldSolicitedServiceUUIDs:
+                advertisementData[CBAdvertisementDataSolicitedServiceUUIDsKey] = LGTraceReadUUIDs(ip, fieldEnd);
+                break;
+            default:
+                break;
+        }
+        ip = fieldEnd;
+    }
+    return advertisementData;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - LGTraceEvent -
+/*----------------------------------------------------*/
+
+@implementation LGTraceEvent
+
+- (NSError *)error
+{
+    if (self.type == LGTraceEventTypeDiscoverPeripheral || ![self.text length]) {
+        return nil;
+    }
+    return [NSError errorWithDomain:self.text code:self.value userInfo:nil];
+}
+
+- (void)appendToData:(NSMutableData *)aData
+{
+    NSMutableData *body = [NSMutableData new];
+    uuid_t identifier = {0};
+    [self.peripheralIdentifier getUUIDBytes:identifier];
+    [body appendBytes:identifier length:sizeof(identifier)];
+    LGTraceAppendUInt32(body, (uint32_t)(int32_t)self.value);
+    LGTraceAppendString(body, self.serviceUUID);
+    LGTraceAppendString(body, self.characteristicUUID);
+    LGTraceAppendString(body, self.text);
+    NSData *payload = self.type == LGTraceEventTypeDiscoverPeripheral ?
+    LGTraceAdvertisementPayload(self.advertisementData) : self.payload;
+    LGTraceAppendUInt32(body, (uint32_t)[payload length]);
+    [body appendData:payload];
+    
+    uint8_t type = self.type;
+    [aData appendBytes:&type length:1];
+    LGTraceAppendUInt64(aData, (uint64_t)(self.timestamp * USEC_PER_SEC));
+    LGTraceAppendUInt32(aData, (uint32_t)[body length]);
+    [aData appendData:body];
+}
+
++ (instancetype)eventFromData:(NSData *)aData offset:(NSUInteger *)anOffset
+{
+    const uint8_t *bytes = [aData bytes];
+    if (*anOffset + kLGTraceRecordHeaderLength > [aData length]) {
+        return nil;
+    }
+    const uint8_t *ip = bytes + *anOffset;
+    const uint8_t *ipEnd = bytes + [aData length];
+    
+    uint8_t type;
+    uint64_t timestamp;
+    uint32_t bodyLength;
+    LGTraceReadBytes(&ip, ipEnd, &type, sizeof(type));
+    LGTraceReadBytes(&ip, ipEnd, &timestamp, sizeof(timestamp));
+    LGTraceReadBytes(&ip, ipEnd, &bodyLength, sizeof(bodyLength));
+    bodyLength = CFSwapInt32LittleToHost(bodyLength);
+    if ((size_t)(ipEnd - ip) < bodyLength) {
+        return nil;
+    }
+    ipEnd = ip + bodyLength;
+    
+    LGTraceEvent *event = [LGTraceEvent new];
+    event.type = type;
+    event.timestamp = (NSTimeInterval)CFSwapInt64LittleToHost(timestamp) / USEC_PER_SEC;
+    
+    uuid_t identifier;
+    uint32_t value;
+    uint32_t payloadLength;
+    NSString *serviceUUID, *characteristicUUID, *text;
+    if (!LGTraceReadBytes(&ip, ipEnd, identifier, sizeof(identifier)) ||
+        !LGTraceReadBytes(&ip, ipEnd, &value, sizeof(value)) ||
+        !LGTraceReadString(&ip, ipEnd, &serviceUUID) ||
+        !LGTraceReadString(&ip, ipEnd, &characteristicUUID) ||
+        !LGTraceReadString(&ip, ipEnd, &text) ||
+        !LGTraceReadBytes(&ip, ipEnd, &payloadLength, sizeof(payloadLength))) {
+        return nil;
+    }
+    payloadLength = CFSwapInt32LittleToHost(payloadLength);
+    if ((size_t)(ipEnd - ip) < payloadLength) {
+        return nil;
+    }
+    event.peripheralIdentifier = [[NSUUID alloc] initWithUUIDBytes:identifier];
+    event.value = (int32_t)CFSwapInt32LittleToHost(value);
+    event.serviceUUID = serviceUUID;
+    event.characteristicUUID = characteristicUUID;
+    event.text = text;
+    event.payload = payloadLength ? [NSData dataWithBytes:ip length:payloadLength] : nil;
+    if (event.type == LGTraceEventTypeDiscoverPeripheral) {
+        event.advertisementData = LGTraceAdvertisementDataFromPayload(event.payload);
+        event.payload = nil;
+    }
+    
+    *anOffset = ipEnd - bytes;
+    return event;
+}
+
+@end
+
+/*----------------------------------------------------*/
+#pragma mark - LGTraceRecorder -
+/*----------------------------------------------------*/
+
+@interface LGTraceRecorder ()
+
+/**
+ * Serial queue on which records are serialized and written
+ */
+@property (strong, nonatomic) dispatch_queue_t traceQueue;
+
+/**
+ * Serialized records which aren't written yet
+ */
+@property (strong, nonatomic) NSMutableData *buffer;
+
+@property (strong, nonatomic) NSFileHandle *fileHandle;
+
+@property (assign, nonatomic) CFAbsoluteTime startTime;
+
+@property (assign, atomic, readwrite) NSUInteger eventsCount;
+
+@property (assign, atomic, readwrite, getter = isFailed) BOOL failed;
+
+@end
+
+@implementation LGTraceRecorder
+
+/*----------------------------------------------------*/
+#pragma mark - Public Methods -
+/*----------------------------------------------------*/
+
+- (void)recordDiscoveryOfPeripheral:(NSUUID *)anIdentifier
+                  advertisementData:(NSDictionary *)advertisementData
+                               RSSI:(NSNumber *)RSSI
+{
+    NSTimeInterval timestamp = CFAbsoluteTimeGetCurrent() - self.startTime;
+    dispatch_async(self.traceQueue, ^{
+        LGTraceEvent *event = [LGTraceEvent new];
+        event.type = LGTraceEventTypeDiscoverPeripheral;
+        event.timestamp = timestamp;
+        event.peripheralIdentifier = anIdentifier;
+        event.value = [RSSI integerValue];
+        event.advertisementData = advertisementData;
+        [self appendEvent:event];
+    });
+}
+
+- (void)recordEventOfType:(LGTraceEventType)aType
+               peripheral:(NSUUID *)anIdentifier
+                  service:(CBUUID *)aService
+           characteristic:(CBUUID *)aCharacteristic
+                    value:(NSInteger)aValue
+                  payload:(NSData *)aPayload
+                    error:(NSError *)anError
+{
+    NSTimeInterval timestamp = CFAbsoluteTimeGetCurrent() - self.startTime;
+    dispatch_async(self.traceQueue, ^{
+        LGTraceEvent *event = [LGTraceEvent new];
+        event.type = aType;
+        event.timestamp = timestamp;
+        event.peripheralIdentifier = anIdentifier;
+        event.value = anError ? anError.code : aValue;
+        event.serviceUUID = [aService representativeString];
+        event.characteristicUUID = [aCharacteristic representativeString];
+        event.text = anError.domain;
+        event.payload = aPayload;
+        [self appendEvent:event];
+    });
+}
+
+- (void)close
+{
+    dispatch_sync(self.traceQueue, ^{
+        [self flush];
+        [self.fileHandle closeFile];
+        self.fileHandle = nil;
+    });
+    LGLog(@"Trace %@ closed with %lu events", self.path, (unsigned long)self.eventsCount);
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Private Methods -
+/*----------------------------------------------------*/
+
+- (void)appendEvent:(LGTraceEvent *)anEvent
+{
+    if (!self.fileHandle) {
+        return;
+    }
+    [anEvent appendToData:self.buffer];
+    self.eventsCount++;
+    if ([self.buffer length] >= kLGTraceFlushThreshold) {
+        [self flush];
+    }
+}
+
+- (void)flush
+{
+    if (![self.buffer length] || !self.fileHandle) {
+        return;
+    }
+    NSError *error = nil;
+    BOOL written = YES;
+    if ([self.fileHandle respondsToSelector:@selector(writeData:error:)]) {
+        written = [self.fileHandle writeData:self.buffer error:&error];
+    } else {
+        // Older systems raise on write failure (e.g. disk is full)
+        @try {
+            [self.fileHandle writeData:self.buffer];
+        } @catch (NSException *exception) {
+            written = NO;
+            error = [NSError errorWithDomain:NSCocoaErrorDomain
+                                        code:NSFileWriteUnknownError
+                                    userInfo:@{NSLocalizedDescriptionKey : exception.reason ? : exception.name}];
+        }
+    }
+    [self.buffer setLength:0];
+    if (!written) {
+        LGLogError(@"Trace %@ recording stopped, write failed - %@", self.path, error);
+        self.failed = YES;
+        @try {
+            [self.fileHandle closeFile];
+        } @catch (NSException *exception) {
+            // Handle is dropped anyway
+        }
+        self.fileHandle = nil;
+    }
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Lifecycle -
+/*----------------------------------------------------*/
+
+- (instancetype)initWithPath:(NSString *)aPath
+{
+    if (![[NSFileManager defaultManager] createFileAtPath:aPath contents:nil attributes:nil]) {
+        LGLogError(@"Can't create trace file %@", aPath);
+        return nil;
+    }
+    if (self = [super init]) {
+        _path = [aPath copy];
+        _fileHandle = [NSFileHandle fileHandleForWritingAtPath:aPath];
+        _traceQueue = dispatch_queue_create("com.LGBluetooth.LGTraceQueue", DISPATCH_QUEUE_SERIAL);
+        _buffer = [NSMutableData dataWithCapacity:kLGTraceFlushThreshold];
+        _startTime = CFAbsoluteTimeGetCurrent();
+        
+        uint32_t version = CFSwapInt32HostToLittle(kLGTraceVersion);
+        [_buffer appendBytes:kLGTraceMagic length:sizeof(kLGTraceMagic)];
+        [_buffer appendBytes:&version length:sizeof(version)];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self flush];
+    [_fileHandle closeFile];
+}
+
+@end
@@ -0,0 +1,93 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+@class LGCentralManager;
+@class LGTraceEvent;
+
+#pragma mark - Error Domains -
+
+/**
+ * Error domain for trace replay errors
+ */
+extern NSString * const kLGTraceReplayErrorDomain;
+
+#pragma mark - Error Codes -
+
+/**
+ * Trace file is missing or has wrong format
+ */
+extern const NSInteger kLGTraceReplayMalformedTraceErrorCode;
+
+#pragma mark - Error Messages -
+
+/**
+ * Error message for missing or malformed traces
+ */
+extern NSString * const kLGTraceReplayMalformedTraceErrorMessage;
+
+#pragma mark - Callback types -
+
+typedef void(^LGTraceReplayEventCallback)(LGTraceEvent *event);
+typedef void(^LGTraceReplayCompletionCallback)(NSUInteger eventsCount, NSTimeInterval duration, NSError *error);
+
+/**
+ * Feeds events recorded by LGTraceRecorder back through LGCentralManager
+ * and LGPeripheral handlers (on main queue, as live events).
+ * Recorded peripherals are replayed by wrappers without CBPeripheral (live peripherals
+ * with the same identifier are untouched), their services and characteristics
+ * are created from recorded UUIDs, so values go through characteristic handlers and codecs
+ */
+@interface LGTraceReplayer : NSObject
+
+/**
+ * Replay speed multiplier, 1 means recorded timing,
+ * 0 means as fast as possible (default is 1)
+ */
+@property (assign, nonatomic) double speed;
+
+/**
+ * Indicates if replay is in progress
+ */
+@property (assign, atomic, readonly, getter = isReplaying) BOOL replaying;
+
+/**
+ * Replays trace through aManager's handlers
+ * @param aManager central manager which will receive events
+ * @param anEventCallback will be called on main queue after each event was handled
+ * @param aCallback will be called on main queue after the last event,
+ * with count of events which reached handlers and wall-clock duration of replay
+ */
+- (void)replayWithManager:(LGCentralManager *)aManager
+                   events:(LGTraceReplayEventCallback)anEventCallback
+               completion:(LGTraceReplayCompletionCallback)aCallback;
+
+/**
+ * Stops ongoing replay, completion will be called with already replayed events count
+ */
+- (void)stop;
+
+/**
+ * @param aPath Path of trace file written by LGTraceRecorder
+ */
+- (instancetype)initWithPath:(NSString *)aPath;
+
+@end
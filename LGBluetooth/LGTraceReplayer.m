@@ -0,0 +1,242 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGTraceReplayer.h"
+
+#import "LGCentralManager.h"
+#import "LGPeripheral.h"
+#import "LGService.h"
+#import "LGCharacteristic.h"
+#import "LGTraceRecorder.h"
+#import "LGUtils.h"
+
+// Error Domains
+NSString * const kLGTraceReplayErrorDomain = @"LGTraceReplayErrorDomain";
+
+// Error Codes
+const NSInteger kLGTraceReplayMalformedTraceErrorCode = 430;
+
+NSString * const kLGTraceReplayMalformedTraceErrorMessage = @"Trace file is missing or malformed";
+
+/**
+ * Count of events delivered to main queue at once, when replaying as fast as possible
+ */
+static const NSUInteger kLGTraceReplayBatchSize = 256;
+
+@interface LGTraceReplayer ()
+
+@property (copy, nonatomic) NSString *path;
+
+/**
+ * Serial queue on which trace is parsed and paced
+ */
+@property (strong, nonatomic) dispatch_queue_t replayQueue;
+
+@property (assign, atomic, readwrite, getter = isReplaying) BOOL replaying;
+
+@property (assign, atomic, getter = isStopped) BOOL stopped;
+
+@end
+
+@implementation LGTraceReplayer
+
+/*----------------------------------------------------*/
+#pragma mark - Public Methods -
+/*----------------------------------------------------*/
+
+- (void)replayWithManager:(LGCentralManager *)aManager
+                   events:(LGTraceReplayEventCallback)anEventCallback
+               completion:(LGTraceReplayCompletionCallback)aCallback
+{
+    self.replaying = YES;
+    self.stopped = NO;
+    double speed = self.speed;
+    dispatch_async(self.replayQueue, ^{
+        NSData *trace = [NSData dataWithContentsOfFile:self.path
+                                               options:NSDataReadingMappedIfSafe
+                                                 error:nil];
+        NSUInteger offset = sizeof(kLGTraceMagic) + sizeof(kLGTraceVersion);
+        uint32_t version = 0;
+        if ([trace length] >= offset) {
+            memcpy(&version, (const uint8_t *)[trace bytes] + sizeof(kLGTraceMagic), sizeof(version));
+        }
+        if ([trace length] < offset || memcmp([trace bytes], kLGTraceMagic, sizeof(kLGTraceMagic)) != 0 ||
+            CFSwapInt32LittleToHost(version) != kLGTraceVersion) {
+            [self finishWithCount:0 duration:0 callback:aCallback
+                            error:[NSError errorWithDomain:kLGTraceReplayErrorDomain
+                                                      code:kLGTraceReplayMalformedTraceErrorCode
+                                                  userInfo:@{kLGErrorMessageKey : kLGTraceReplayMalformedTraceErrorMessage}]];
+            return;
+        }
+        
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSUInteger count = 0;
+        NSMutableArray *batch = [NSMutableArray new];
+        LGTraceEvent *event = nil;
+        while (!self.isStopped && (event = [LGTraceEvent eventFromData:trace offset:&offset])) {
+            if (speed > 0) {
+                // Pacing by recorded timestamps
+                NSTimeInterval delay = event.timestamp / speed - (CFAbsoluteTimeGetCurrent() - start);
+                if (delay > 0) {
+                    [NSThread sleepForTimeInterval:delay];
+                }
+            }
+            [batch addObject:event];
+            if (speed > 0 || [batch count] >= kLGTraceReplayBatchSize) {
+                count += [self deliverEvents:batch toManager:aManager callback:anEventCallback];
+                [batch removeAllObjects];
+            }
+        }
+        count += [self deliverEvents:batch toManager:aManager callback:anEventCallback];
+        
+        [self finishWithCount:count duration:CFAbsoluteTimeGetCurrent() - start callback:aCallback error:nil];
+    });
+}
+
+- (void)stop
+{
+    self.stopped = YES;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Private Methods -
+/*----------------------------------------------------*/
+
+- (void)finishWithCount:(NSUInteger)aCount
+               duration:(NSTimeInterval)aDuration
+               callback:(LGTraceReplayCompletionCallback)aCallback
+                  error:(NSError *)anError
+{
+    dispatch_async(dispatch_get_main_queue(), ^{
+        self.replaying = NO;
+        LGLog(@"Replayed %lu events in %.3f sec", (unsigned long)aCount, aDuration);
+        if (aCallback) {
+            aCallback(aCount, aDuration, anError);
+        }
+    });
+}
+
+/**
+ * Handles events on main queue, waits until they are handled
+ * @return Count of events which reached handlers
+ */
+- (NSUInteger)deliverEvents:(NSArray *)anEvents
+                  toManager:(LGCentralManager *)aManager
+                   callback:(LGTraceReplayEventCallback)aCallback
+{
+    if (![anEvents count]) {
+        return 0;
+    }
+    __block NSUInteger handledCount = 0;
+    dispatch_sync(dispatch_get_main_queue(), ^{
+        for (LGTraceEvent *event in anEvents) {
+            if ([self handleEvent:event manager:aManager]) {
+                handledCount++;
+            }
+            if (aCallback) {
+                aCallback(event);
+            }
+        }
+    });
+    return handledCount;
+}
+
+/**
+ * Feeds anEvent to wrappers created for replay (live peripherals are never touched),
+ * service and characteristic wrappers are created from recorded UUIDs
+ * @return NO if event can't be replayed
+ */
+- (BOOL)handleEvent:(LGTraceEvent *)anEvent manager:(LGCentralManager *)aManager
+{
+    if (anEvent.type == LGTraceEventTypeUpdateState) {
+        // Central state can't be faked, delivered by callback only
+        return NO;
+    }
+    LGPeripheral *peripheral = [aManager wrapperByIdentifier:anEvent.peripheralIdentifier];
+    if (!peripheral) {
+        return NO;
+    }
+    NSError *error = [anEvent error];
+    LGCharacteristic *characteristic = nil;
+    switch (anEvent.type) {
+        case LGTraceEventTypeDiscoverPeripheral:
+            [aManager handleDiscoveredPeripheral:peripheral
+                               advertisementData:anEvent.advertisementData
+                                            RSSI:@(anEvent.value)];
+            break;
+        case LGTraceEventTypeConnect:
+        case LGTraceEventTypeFailToConnect:
+            [aManager handleConnectedPeripheral:peripheral error:error];
+            break;
+        case LGTraceEventTypeDisconnect:
+            [aManager handleDisconnectedPeripheral:peripheral error:error];
+            break;
+        case LGTraceEventTypeDiscoverServices:
+            [peripheral handleDiscoveredServicesWithError:error];
+            break;
+        case LGTraceEventTypeDiscoverCharacteristics: {
+            LGService *service = [peripheral replayServiceWithUUID:anEvent.serviceUUID];
+            [service handleDiscoveredCharacteristics:nil error:error];
+            return service != nil;
+        }
+        case LGTraceEventTypeUpdateValue:
+            characteristic = [peripheral replayCharacteristicWithUUID:anEvent.characteristicUUID
+                                                          serviceUUID:anEvent.serviceUUID];
+            [characteristic handleReadValue:anEvent.payload error:error];
+            return characteristic != nil;
+        case LGTraceEventTypeWriteValue:
+            characteristic = [peripheral replayCharacteristicWithUUID:anEvent.characteristicUUID
+                                                          serviceUUID:anEvent.serviceUUID];
+            [characteristic handleWrittenValueWithError:error];
+            return characteristic != nil;
+        case LGTraceEventTypeUpdateNotificationState:
+            characteristic = [peripheral replayCharacteristicWithUUID:anEvent.characteristicUUID
+                                                          serviceUUID:anEvent.serviceUUID];
+            [characteristic handleSetNotifiedWithError:error];
+            return characteristic != nil;
+        case LGTraceEventTypeReadRSSI:
+            [peripheral handleReadRSSI:error ? nil : @(anEvent.value) error:error];
+            break;
+        case LGTraceEventTypeReadyToSendWriteWithoutResponse:
+            [peripheral.scheduler handleReadyToSendWriteWithoutResponse];
+            break;
+        default:
+            return NO;
+    }
+    return YES;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Lifecycle -
+/*----------------------------------------------------*/
+
+- (instancetype)initWithPath:(NSString *)aPath
+{
+    if (self = [super init]) {
+        _path = [aPath copy];
+        _speed = 1;
+        _replayQueue = dispatch_queue_create("com.LGBluetooth.LGTraceReplayQueue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+@end
@@ -0,0 +1,375 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "LGBluetooth.h"
+#import "CBUUID+StringExtraction.h"
+
+/*----------------------------------------------------*/
+#pragma mark - Private API used by benchmarks -
+/*----------------------------------------------------*/
+
+@interface LGCentralManager (LGBenchmarks)
+
+- (LGPeripheral *)wrapperByPeripheral:(CBPeripheral *)aPeripheral;
+
+@end
+
+@interface LGPeripheral (LGBenchmarks)
+
+- (LGService *)wrapperByService:(CBService *)aService;
+
+@end
+
+@interface LGUtils (LGBenchmarks)
+
++ (LGCharacteristic *)findCharacteristicInList:(NSArray *)characteristics
+                                        byUUID:(NSString *)anID;
+
++ (LGService *)findServiceInList:(NSArray *)services
+                          byUUID:(NSString *)anID;
+
+@end
+
+/*----------------------------------------------------*/
+#pragma mark - LGBenchmarkPeripheral -
+/*----------------------------------------------------*/
+
+/**
+ * Stand-in for CBPeripheral, which can't be created outside of CoreBluetooth.
+ * Attached to wrappers by KVC, so wrapperByPeripheral: runs its real pointer matching
+ */
+@interface LGBenchmarkPeripheral : NSObject
+
+@property (weak, nonatomic) id delegate;
+
+@property (strong, nonatomic) NSUUID *identifier;
+
+@end
+
+@implementation LGBenchmarkPeripheral
+
+@end
+
+/*----------------------------------------------------*/
+#pragma mark - Harness -
+/*----------------------------------------------------*/
+
+/**
+ * Fixture sizes, kept fixed so results are comparable between runs
+ */
+static const NSUInteger kLGBenchmarkPeripheralsCount     = 200;
+static const NSUInteger kLGBenchmarkServicesCount        = 10;
+static const NSUInteger kLGBenchmarkCharacteristicsCount = 20;
+static const NSUInteger kLGBenchmarkCallbacksDepth       = 16;
+static const NSUInteger kLGBenchmarkWarmupIterations     = 1000;
+static const NSUInteger kLGBenchmarkSamplesCount         = 7;
+
+typedef void (^LGBenchmarkBody)(NSUInteger iteration);
+
+/**
+ * Runs aBody anIterations times per sample, after a warmup pass
+ * @return Result dictionary, nil if aName doesn't match aFilter
+ */
+static NSDictionary *LGRunBenchmark(NSString *aFilter, NSString *aName,
+                                    NSUInteger anIterations, LGBenchmarkBody aBody)
+{
+    if (aFilter && [aName rangeOfString:aFilter].location == NSNotFound) {
+        return nil;
+    }
+    @autoreleasepool {
+        for (NSUInteger i = 0; i < MIN(anIterations, kLGBenchmarkWarmupIterations); i++) {
+            aBody(i);
+        }
+    }
+    NSMutableArray *samples = [NSMutableArray new];
+    for (NSUInteger sample = 0; sample < kLGBenchmarkSamplesCount; sample++) {
+        @autoreleasepool {
+            NSTimeInterval start = [[NSProcessInfo processInfo] systemUptime];
+            for (NSUInteger i = 0; i < anIterations; i++) {
+                aBody(i);
+            }
+            NSTimeInterval elapsed = [[NSProcessInfo processInfo] systemUptime] - start;
+            [samples addObject:@(elapsed * NSEC_PER_SEC / anIterations)];
+        }
+    }
+    [samples sortUsingSelector:@selector(compare:)];
+    double median = [samples[kLGBenchmarkSamplesCount / 2] doubleValue];
+    
+    return @{@"name"              : aName,
+             @"iterations"        : @(anIterations),
+             @"samples"           : @(kLGBenchmarkSamplesCount),
+             @"ns_per_op_median"  : @(median),
+             @"ns_per_op_min"     : [samples firstObject],
+             @"ns_per_op_max"     : [samples lastObject],
+             @"ops_per_sec"       : @(median > 0 ? NSEC_PER_SEC / median : 0)};
+}
+
+/**
+ * @return Deterministic identifier, unique for anIndex
+ */
+static NSUUID *LGBenchmarkIdentifier(NSUInteger anIndex)
+{
+    uuid_t bytes;
+    for (NSUInteger i = 0; i < sizeof(uuid_t); i++) {
+        bytes[i] = (uint8_t)(i * 17 + 0x42);
+    }
+    bytes[0] = (uint8_t)(anIndex >> 8);
+    bytes[1] = (uint8_t)anIndex;
+    return [[NSUUID alloc] initWithUUIDBytes:bytes];
+}
+
+/**
+ * @return Deterministic 128 bit UUID, unique for anIndex
+ */
+static CBUUID *LGBenchmarkUUID(NSUInteger anIndex)
+{
+    return [CBUUID UUIDWithNSUUID:LGBenchmarkIdentifier(anIndex)];
+}
+
+/**
+ * Linear congruential generator, seeded, so fixtures don't change between runs
+ */
+static uint32_t LGBenchmarkRandom(uint32_t *aSeed)
+{
+    *aSeed = *aSeed * 1664525u + 1013904223u;
+    return *aSeed >> 8;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Fixtures -
+/*----------------------------------------------------*/
+
+static NSArray *LGBenchmarkIdentifiers(void)
+{
+    NSMutableArray *identifiers = [NSMutableArray new];
+    for (NSUInteger i = 0; i < kLGBenchmarkPeripheralsCount; i++) {
+        [identifiers addObject:LGBenchmarkIdentifier(i)];
+    }
+    return identifiers;
+}
+
+static NSDictionary *LGBenchmarkAdvertisementData(void)
+{
+    uint8_t manufacturerData[] = {0x4C, 0x00, 0x02, 0x15, 0x01, 0x02, 0x03, 0x04};
+    return @{CBAdvertisementDataLocalNameKey        : @"LGBenchmark",
+             CBAdvertisementDataManufacturerDataKey : [NSData dataWithBytes:manufacturerData
+                                                                     length:sizeof(manufacturerData)],
+             CBAdvertisementDataServiceUUIDsKey     : @[[CBUUID UUIDWithString:@"180D"],
+                                                        LGBenchmarkUUID(0xFFFF)],
+             CBAdvertisementDataIsConnectable       : @YES};
+}
+
+static NSArray *LGBenchmarkPeripherals(NSArray *identifiers)
+{
+    NSMutableArray *peripherals = [NSMutableArray new];
+    for (NSUUID *identifier in identifiers) {
+        LGBenchmarkPeripheral *peripheral = [LGBenchmarkPeripheral new];
+        peripheral.identifier = identifier;
+        [peripherals addObject:peripheral];
+    }
+    return peripherals;
+}
+
+/**
+ * @param cbPeripherals stand-ins attached to wrappers, nil for replay-only wrappers
+ * @return Manager with kLGBenchmarkPeripheralsCount scanned peripherals
+ */
+static LGCentralManager *LGBenchmarkManager(NSArray *identifiers, NSArray *cbPeripherals)
+{
+    LGCentralManager *manager = [LGCentralManager new];
+    NSDictionary *advertisementData = LGBenchmarkAdvertisementData();
+    uint32_t seed = 1;
+    for (NSUInteger i = 0; i < [identifiers count]; i++) {
+        LGPeripheral *peripheral = [manager wrapperByIdentifier:identifiers[i]];
+        if (cbPeripherals) {
+            [peripheral setValue:cbPeripherals[i] forKey:@"cbPeripheral"];
+        }
+        [manager handleDiscoveredPeripheral:peripheral
+                          advertisementData:advertisementData
+                                       RSSI:@(-30 - (NSInteger)(LGBenchmarkRandom(&seed) % 70))];
+    }
+    return manager;
+}
+
+static NSArray *LGBenchmarkCharacteristics(void)
+{
+    NSMutableArray *characteristics = [NSMutableArray new];
+    for (NSUInteger i = 0; i < kLGBenchmarkCharacteristicsCount; i++) {
+        CBMutableCharacteristic *cbCharacteristic =
+        [[CBMutableCharacteristic alloc] initWithType:LGBenchmarkUUID(0x1000 + i)
+                                           properties:CBCharacteristicPropertyRead | CBCharacteristicPropertyWrite
+                                                value:nil
+                                          permissions:CBAttributePermissionsReadable | CBAttributePermissionsWriteable];
+        [characteristics addObject:cbCharacteristic];
+    }
+    return characteristics;
+}
+
+/*----------------------------------------------------*/
+#pragma mark - Main -
+/*----------------------------------------------------*/
+
+int main(int argc, const char * argv[])
+{
+    @autoreleasepool {
+        NSString *filter = argc > 1 ? @(argv[1]) : nil;
+        NSMutableArray *results = [NSMutableArray new];
+        void (^addResult)(NSDictionary *) = ^(NSDictionary *aResult) {
+            if (aResult) {
+                [results addObject:aResult];
+            }
+        };
+        
+        NSArray *identifiers = LGBenchmarkIdentifiers();
+        NSArray *cbPeripherals = LGBenchmarkPeripherals(identifiers);
+        NSDictionary *advertisementData = LGBenchmarkAdvertisementData();
+        
+        // ----- Advertisement ingestion -----/
+        
+        // Same path as centralManager:didDiscoverPeripheral:advertisementData:RSSI:
+        LGCentralManager *ingestingManager = LGBenchmarkManager(identifiers, cbPeripherals);
+        addResult(LGRunBenchmark(filter, @"advertisement_ingestion", 100000, ^(NSUInteger i) {
+            LGPeripheral *peripheral = [ingestingManager wrapperByPeripheral:cbPeripherals[(i * 7919) % kLGBenchmarkPeripheralsCount]];
+            [ingestingManager handleDiscoveredPeripheral:peripheral
+                                       advertisementData:advertisementData
+                                                    RSSI:@(-30 - (NSInteger)(i % 70))];
+        }));
+        
+        // ----- Wrapper lookups -----/
+        
+        LGCentralManager *manager = LGBenchmarkManager(identifiers, cbPeripherals);
+        addResult(LGRunBenchmark(filter, @"lookup_wrapper_by_peripheral", 100000, ^(NSUInteger i) {
+            [manager wrapperByPeripheral:cbPeripherals[(i * 7919) % kLGBenchmarkPeripheralsCount]];
+        }));
+        
+        // Replay path
+        LGCentralManager *replayManager = LGBenchmarkManager(identifiers, nil);
+        addResult(LGRunBenchmark(filter, @"lookup_wrapper_by_identifier", 100000, ^(NSUInteger i) {
+            [replayManager wrapperByIdentifier:identifiers[(i * 7919) % kLGBenchmarkPeripheralsCount]];
+        }));
+        
+        LGPeripheral *peripheral = [manager wrapperByPeripheral:cbPeripherals[0]];
+        NSMutableArray *cbServices = [NSMutableArray new];
+        NSMutableArray *services = [NSMutableArray new];
+        for (NSUInteger i = 0; i < kLGBenchmarkServicesCount; i++) {
+            CBMutableService *cbService = [[CBMutableService alloc] initWithType:LGBenchmarkUUID(0x100 + i)
+                                                                         primary:YES];
+            [cbServices addObject:cbService];
+            [services addObject:[[LGService alloc] initWithService:cbService]];
+        }
+        [peripheral setValue:services forKey:@"services"];
+        addResult(LGRunBenchmark(filter, @"lookup_wrapper_by_service", 1000000, ^(NSUInteger i) {
+            [peripheral wrapperByService:cbServices[i % kLGBenchmarkServicesCount]];
+        }));
+        
+        NSArray *cbCharacteristics = LGBenchmarkCharacteristics();
+        NSMutableArray *characteristics = [NSMutableArray new];
+        for (CBCharacteristic *cbCharacteristic in cbCharacteristics) {
+            [characteristics addObject:[[LGCharacteristic alloc] initWithCharacteristic:cbCharacteristic]];
+        }
+        LGService *service = [services firstObject];
+        service.characteristics = characteristics;
+        addResult(LGRunBenchmark(filter, @"lookup_wrapper_by_characteristic", 1000000, ^(NSUInteger i) {
+            [service wrapperByCharacteristic:cbCharacteristics[i % kLGBenchmarkCharacteristicsCount]];
+        }));
+        
+        // ----- Peripherals sort -----/
+        
+        addResult(LGRunBenchmark(filter, @"peripherals_sort", 10000, ^(NSUInteger i) {
+            [manager peripherals];
+        }));
+        
+        // ----- UUID string extraction -----/
+        
+        CBUUID *shortUUID = [CBUUID UUIDWithString:@"180D"];
+        CBUUID *longUUID = LGBenchmarkUUID(0xABCD);
+        addResult(LGRunBenchmark(filter, @"representative_string_16bit", 1000000, ^(NSUInteger i) {
+            [shortUUID representativeString];
+        }));
+        addResult(LGRunBenchmark(filter, @"representative_string_128bit", 1000000, ^(NSUInteger i) {
+            [longUUID representativeString];
+        }));
+        
+        // ----- LGUtils UUID matching -----/
+        
+        NSMutableArray *characteristicIDs = [NSMutableArray new];
+        for (LGCharacteristic *characteristic in characteristics) {
+            [characteristicIDs addObject:[characteristic.UUIDString lowercaseString]];
+        }
+        NSMutableArray *serviceIDs = [NSMutableArray new];
+        for (LGService *aService in services) {
+            [serviceIDs addObject:[aService.UUIDString lowercaseString]];
+        }
+        addResult(LGRunBenchmark(filter, @"utils_find_characteristic", 100000, ^(NSUInteger i) {
+            [LGUtils findCharacteristicInList:characteristics
+                                       byUUID:characteristicIDs[i % kLGBenchmarkCharacteristicsCount]];
+        }));
+        addResult(LGRunBenchmark(filter, @"utils_find_service", 100000, ^(NSUInteger i) {
+            [LGUtils findServiceInList:services
+                                byUUID:serviceIDs[i % kLGBenchmarkServicesCount]];
+        }));
+        
+        // ----- Characteristic callback queues -----/
+        
+        // Detached characteristic sends operations immediately (to nil peripheral),
+        // so only pushing and popping of callbacks is measured
+        LGCharacteristic *characteristic = [characteristics firstObject];
+        NSData *value = [@"LGBenchmark" dataUsingEncoding:NSUTF8StringEncoding];
+        __block NSUInteger callbacksCount = 0;
+        addResult(LGRunBenchmark(filter, @"characteristic_read_callbacks", 10000, ^(NSUInteger i) {
+            for (NSUInteger j = 0; j < kLGBenchmarkCallbacksDepth; j++) {
+                [characteristic readValueWithBlock:^(NSData *data, NSError *error) {
+                    callbacksCount++;
+                }];
+            }
+            for (NSUInteger j = 0; j < kLGBenchmarkCallbacksDepth; j++) {
+                [characteristic handleReadValue:value error:nil];
+            }
+        }));
+        addResult(LGRunBenchmark(filter, @"characteristic_write_callbacks", 10000, ^(NSUInteger i) {
+            for (NSUInteger j = 0; j < kLGBenchmarkCallbacksDepth; j++) {
+                [characteristic writeValue:value completion:^(NSError *error) {
+                    callbacksCount++;
+                }];
+            }
+            for (NSUInteger j = 0; j < kLGBenchmarkCallbacksDepth; j++) {
+                [characteristic handleWrittenValueWithError:nil];
+            }
+        }));
+        
+        NSDictionary *report = @{@"suite"                : @"LGBluetoothBenchmarks",
+                                 @"peripherals"          : @(kLGBenchmarkPeripheralsCount),
+                                 @"callbacks_delivered"  : @(callbacksCount),
+                                 @"results"              : results};
+        NSError *error;
+        NSData *json = [NSJSONSerialization dataWithJSONObject:report
+                                                       options:NSJSONWritingPrettyPrinted
+                                                         error:&error];
+        if (!json) {
+            fprintf(stderr, "%s\n", [[error localizedDescription] UTF8String]);
+            return 1;
+        }
+        fwrite([json bytes], 1, [json length], stdout);
+        fputc('\n', stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+
+#import "LGCodec.h"
+
+@interface LGCodecTests : XCTestCase
+
+@end
+
+@implementation LGCodecTests
+
+/**
+ * @return Deterministic pseudo random bytes
+ */
+- (NSData *)randomDataWithLength:(NSUInteger)aLength seed:(uint32_t)aSeed
+{
+    NSMutableData *data = [NSMutableData dataWithLength:aLength];
+    uint8_t *bytes = [data mutableBytes];
+    for (NSUInteger i = 0; i < aLength; i++) {
+        aSeed = aSeed * 1664525u + 1013904223u;
+        bytes[i] = (uint8_t)(aSeed >> 24);
+    }
+    return data;
+}
+
+- (NSData *)repetitiveDataWithLength:(NSUInteger)aLength
+{
+    NSMutableData *data = [NSMutableData dataWithLength:aLength];
+    uint8_t *bytes = [data mutableBytes];
+    for (NSUInteger i = 0; i < aLength; i++) {
+        bytes[i] = (uint8_t)(i % 7);
+    }
+    return data;
+}
+
+#pragma mark - LGLZCodec -
+
+- (void)testLZRoundTrip
+{
+    LGLZCodec *codec = [LGLZCodec new];
+    NSArray *payloads = @[[NSData data],
+                          [self randomDataWithLength:3 seed:1],
+                          [self randomDataWithLength:1000 seed:2],
+                          [self repetitiveDataWithLength:5000]];
+    for (NSData *payload in payloads) {
+        NSError *error = nil;
+        NSData *decoded = [codec decodeData:[codec encodeData:payload] error:&error];
+        XCTAssertNil(error);
+        XCTAssertEqualObjects(decoded, payload);
+    }
+}
+
+- (void)testLZCompressesRepetitiveData
+{
+    NSData *payload = [self repetitiveDataWithLength:5000];
+    XCTAssertLessThan([[[LGLZCodec new] encodeData:payload] length], [payload length] / 10);
+}
+
+- (void)testLZNeverExpandsMoreThanHeaderByte
+{
+    NSData *payload = [self randomDataWithLength:1000 seed:3];
+    XCTAssertLessThanOrEqual([[[LGLZCodec new] encodeData:payload] length], [payload length] + 1);
+}
+
+- (void)testLZRejectsMalformedData
+{
+    LGLZCodec *codec = [LGLZCodec new];
+    NSData *encoded = [codec encodeData:[self repetitiveDataWithLength:5000]];
+    NSError *error = nil;
+    XCTAssertNil([codec decodeData:[encoded subdataWithRange:NSMakeRange(0, [encoded length] / 2)] error:&error]);
+    XCTAssertEqualObjects(error.domain, kLGCodecErrorDomain);
+    XCTAssertEqual(error.code, kLGCodecMalformedDataErrorCode);
+}
+
+#pragma mark - LGDeltaCodec -
+
+- (void)testDeltaRoundTrip
+{
+    LGDeltaCodec *sender = [LGDeltaCodec new];
+    LGDeltaCodec *receiver = [LGDeltaCodec new];
+    NSMutableData *value = [[self randomDataWithLength:64 seed:4] mutableCopy];
+    for (NSUInteger i = 0; i < 20; i++) {
+        ((uint8_t *)[value mutableBytes])[i] ^= 0x5A;
+        if (i % 5 == 0) {
+            [value appendData:[self randomDataWithLength:i seed:(uint32_t)i]];
+        }
+        NSError *error = nil;
+        XCTAssertEqualObjects([receiver decodeData:[sender encodeData:value] error:&error], value);
+        XCTAssertNil(error);
+    }
+}
+
+- (void)testDeltaResynchronisesAfterFailedWrite
+{
+    LGDeltaCodec *sender = [LGDeltaCodec new];
+    LGDeltaCodec *receiver = [LGDeltaCodec new];
+    NSData *first = [self randomDataWithLength:32 seed:5];
+    NSData *lost = [self randomDataWithLength:32 seed:6];
+    NSData *next = [self randomDataWithLength:32 seed:7];
+    
+    XCTAssertEqualObjects([receiver decodeData:[sender encodeData:first] error:nil], first);
+    // Write failed, peer never saw the value
+    [sender encodeData:lost];
+    [sender reset];
+    XCTAssertEqualObjects([receiver decodeData:[sender encodeData:next] error:nil], next);
+    XCTAssertEqualObjects([receiver decodeData:[sender encodeData:first] error:nil], first);
+}
+
+- (void)testDeltaResetKeepsDecodingReference
+{
+    LGDeltaCodec *peer = [LGDeltaCodec new];
+    LGDeltaCodec *codec = [LGDeltaCodec new];
+    NSData *first = [self randomDataWithLength:16 seed:8];
+    NSData *second = [self randomDataWithLength:16 seed:9];
+    
+    XCTAssertEqualObjects([codec decodeData:[peer encodeData:first] error:nil], first);
+    [codec reset];
+    XCTAssertEqualObjects([codec decodeData:[peer encodeData:second] error:nil], second);
+}
+
+- (void)testDeltaWithoutReferenceFails
+{
+    LGDeltaCodec *sender = [LGDeltaCodec new];
+    [sender encodeData:[self randomDataWithLength:16 seed:10]];
+    NSData *delta = [sender encodeData:[self randomDataWithLength:16 seed:11]];
+    
+    NSError *error = nil;
+    XCTAssertNil([[LGDeltaCodec new] decodeData:delta error:&error]);
+    XCTAssertEqual(error.code, kLGCodecMalformedDataErrorCode);
+}
+
+- (void)testDeltaAndLZChainRoundTrip
+{
+    NSArray *senderCodecs = @[[LGDeltaCodec new], [LGLZCodec new]];
+    NSArray *receiverCodecs = @[[LGDeltaCodec new], [LGLZCodec new]];
+    NSMutableData *value = [[self repetitiveDataWithLength:512] mutableCopy];
+    for (NSUInteger i = 0; i < 10; i++) {
+        ((uint8_t *)[value mutableBytes])[i * 13] = (uint8_t)i;
+        NSData *encoded = value;
+        for (id<LGCodec> codec in senderCodecs) {
+            encoded = [codec encodeData:encoded];
+        }
+        NSData *decoded = encoded;
+        for (id<LGCodec> codec in [receiverCodecs reverseObjectEnumerator]) {
+            decoded = [codec decodeData:decoded error:nil];
+        }
+        XCTAssertEqualObjects(decoded, value);
+    }
+}
+
+@end
@@ -0,0 +1,284 @@
+// The MIT License (MIT)
+//
+// Created by : l0gg3r
+// Copyright (c) 2014 l0gg3r. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+
+#import "LGOperationScheduler.h"
+
+@interface LGOperationSchedulerTests : XCTestCase
+
+@property (strong, nonatomic) LGOperationScheduler *scheduler;
+
+/**
+ * Names of operations in the order they were sent
+ */
+@property (strong, nonatomic) NSMutableArray *sent;
+
+@end
+
+@implementation LGOperationSchedulerTests
+
+- (void)setUp
+{
+    [super setUp];
+    self.scheduler = [LGOperationScheduler new];
+    self.sent = [NSMutableArray new];
+}
+
+- (void)tearDown
+{
+    [self.scheduler cancelAllOperations];
+    [super tearDown];
+}
+
+- (void)enqueue:(NSString *)aName
+       priority:(LGOperationPriority)aPriority
+           type:(LGOperationType)aType
+            key:(id)aKey
+expectsResponse:(BOOL)expectsResponse
+        failure:(LGOperationSchedulerFailureCallback)aFailureCallback
+{
+    NSMutableArray *sent = self.sent;
+    [self.scheduler enqueueOperationWithPriority:aPriority
+                                            type:aType
+                                             key:aKey
+                                 expectsResponse:expectsResponse
+                                           block:^{
+                                               [sent addObject:aName];
+                                           }
+                                         failure:aFailureCallback];
+}
+
+- (void)enqueueWrite:(NSString *)aName priority:(LGOperationPriority)aPriority key:(id)aKey
+{
+    [self enqueue:aName priority:aPriority type:LGOperationTypeWrite key:aKey expectsResponse:YES failure:nil];
+}
+
+- (void)enqueueWriteWithoutResponse:(NSString *)aName priority:(LGOperationPriority)aPriority key:(id)aKey
+{
+    [self enqueue:aName priority:aPriority type:LGOperationTypeWrite key:aKey expectsResponse:NO failure:nil];
+}
+
+- (void)spinRunLoopFor:(NSTimeInterval)anInterval
+{
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:anInterval]];
+}
+
+#pragma mark - Pipelining -
+
+- (void)testPipeliningDepthLimitsInFlightOperations
+{
+    self.scheduler.pipeliningDepth = 2;
+    for (NSUInteger i = 0; i < 5; i++) {
+        [self enqueueWrite:[@(i) stringValue] priority:LGOperationPriorityDefault key:@"key"];
+    }
+    XCTAssertEqualObjects(self.sent, (@[@"0", @"1"]));
+    XCTAssertEqual(self.scheduler.inFlightCount, 2u);
+    XCTAssertEqual(self.scheduler.queueDepth, 3u);
+    
+    [self.scheduler completeOperationWithType:LGOperationTypeWrite key:@"key"];
+    XCTAssertEqualObjects(self.sent, (@[@"0", @"1", @"2"]));
+    XCTAssertEqual(self.scheduler.inFlightCount, 2u);
+}
+
+- (void)testResponseOfOtherTypeDoesNotCompleteOperation
+{
+    [self enqueueWrite:@"write" priority:LGOperationPriorityDefault key:@"key"];
+    [self enqueueWrite:@"next" priority:LGOperationPriorityDefault key:@"key"];
+    [self.scheduler completeOperationWithType:LGOperationTypeRead key:@"key"];
+    XCTAssertEqualObjects(self.sent, (@[@"write"]));
+}
+
+#pragma mark - Priorities -
+
+- (void)testControlOperationOvertakesBulkOperations
+{
+    for (NSUInteger i = 0; i < 3; i++) {
+        [self enqueueWrite:[NSString stringWithFormat:@"bulk%lu", (unsigned long)i]
+                  priority:LGOperationPriorityBulk
+                       key:@"bulk"];
+    }
+    [self enqueueWrite:@"control" priority:LGOperationPriorityControl key:@"control"];
+    XCTAssertEqualObjects(self.sent, (@[@"bulk0"]));
+    
+    [self.scheduler completeOperationWithType:LGOperationTypeWrite key:@"bulk"];
+    XCTAssertEqualObjects(self.sent, (@[@"bulk0", @"control"]));
+}
+
+- (void)testLanesOfSamePriorityAreInterleaved
+{
+    self.scheduler.pipeliningDepth = 1;
+    [self enqueueWrite:@"first" priority:LGOperationPriorityDefault key:@"block"];
+    [self enqueueWrite:@"a0" priority:LGOperationPriorityDefault key:@"a"];
+    [self enqueueWrite:@"a1" priority:LGOperationPriorityDefault key:@"a"];
+    [self enqueueWrite:@"b0" priority:LGOperationPriorityDefault key:@"b"];
+    [self.scheduler completeOperationWithType:LGOperationTypeWrite key:@"block"];
+    [self.scheduler completeOperationWithType:LGOperationTypeWrite key:@"a"];
+    [self.scheduler completeOperationWithType:LGOperationTypeWrite key:@"b"];
+    XCTAssertEqualObjects(self.sent, (@[@"first", @"a0", @"b0", @"a1"]));
+}
+
+#pragma mark - Write without response window -
+
+- (void)testWritesWithoutResponseAreHeldByWindow
+{
+    self.scheduler.writeWithoutResponseWindow = 3;
+    self.scheduler.writeWithoutResponseRefillInterval = 1000;
+    for (NSUInteger i = 0; i < 10; i++) {
+        [self enqueueWriteWithoutResponse:@"bulk" priority:LGOperationPriorityBulk key:@"bulk"];
+    }
+    XCTAssertEqual([self.sent count], 3u);
+    XCTAssertEqual(self.scheduler.queueDepth, 7u);
+    
+    [self.scheduler handleReadyToSendWriteWithoutResponse];
+    XCTAssertEqual([self.sent count], 6u);
+}
+
+- (void)testControlWriteOvertakesHeldBulkWrites
+{
+    self.scheduler.writeWithoutResponseWindow = 2;
+    self.scheduler.writeWithoutResponseRefillInterval = 1000;
+    for (NSUInteger i = 0; i < 10; i++) {
+        [self enqueueWriteWithoutResponse:@"bulk" priority:LGOperationPriorityBulk key:@"bulk"];
+    }
+    [self enqueueWriteWithoutResponse:@"stop" priority:LGOperationPriorityControl key:@"control"];
+    XCTAssertEqualObjects(self.sent, (@[@"bulk", @"bulk", @"stop"]));
+    
+    [self.scheduler handleReadyToSendWriteWithoutResponse];
+    XCTAssertEqual([self.sent count], 5u);
+}
+
+- (void)testWindowIsRefilledByTimer
+{
+    self.scheduler.writeWithoutResponseWindow = 2;
+    self.scheduler.writeWithoutResponseRefillInterval = 0.01;
+    for (NSUInteger i = 0; i < 4; i++) {
+        [self enqueueWriteWithoutResponse:@"bulk" priority:LGOperationPriorityBulk key:@"bulk"];
+    }
+    XCTAssertEqual([self.sent count], 2u);
+    [self spinRunLoopFor:0.1];
+    XCTAssertEqual([self.sent count], 4u);
+}
+
+- (void)testWritesWaitForReadiness
+{
+    __block BOOL ready = NO;
+    self.scheduler.writeWithoutResponseReadinessBlock = ^BOOL{
+        return ready;
+    };
+    [self enqueueWriteWithoutResponse:@"write" priority:LGOperationPriorityDefault key:@"key"];
+    XCTAssertEqual([self.sent count], 0u);
+    
+    ready = YES;
+    [self.scheduler handleReadyToSendWriteWithoutResponse];
+    XCTAssertEqualObjects(self.sent, (@[@"write"]));
+}
+
+#pragma mark - Notify and read -
+
+- (void)testReadAfterNotifyIsCompletedByValueUpdate
+{
+    // Same calls LGPeripheral makes for "subscribe, then read the initial value"
+    [self enqueue:@"notify" priority:LGOperationPriorityDefault type:LGOperationTypeNotify
+              key:@"characteristic" expectsResponse:YES failure:nil];
+    [self enqueue:@"read" priority:LGOperationPriorityDefault type:LGOperationTypeRead
+              key:@"characteristic" expectsResponse:YES failure:nil];
+    [self enqueueWrite:@"write" priority:LGOperationPriorityDefault key:@"other"];
+    
+    // Notification before read was sent completes nothing
+    [self.scheduler completeOperationWithType:LGOperationTypeRead key:@"characteristic"];
+    XCTAssertEqualObjects(self.sent, (@[@"notify"]));
+    
+    [self.scheduler completeOperationWithType:LGOperationTypeNotify key:@"characteristic"];
+    XCTAssertEqualObjects(self.sent, (@[@"notify", @"read"]));
+    
+    // Read response arrives while characteristic is notifying
+    [self.scheduler completeOperationWithType:LGOperationTypeRead key:@"characteristic"];
+    XCTAssertEqualObjects(self.sent, (@[@"notify", @"read", @"write"]));
+    XCTAssertEqual(self.scheduler.inFlightCount, 1u);
+}
+
+#pragma mark - Failures -
+
+- (void)testInFlightOperationTimesOut
+{
+    self.scheduler.responseTimeout = 0.05;
+    __block NSError *failure = nil;
+    [self enqueue:@"lost" priority:LGOperationPriorityDefault type:LGOperationTypeWrite
+              key:@"key" expectsResponse:YES failure:^(NSError *error) {
+                  failure = error;
+              }];
+    [self enqueueWrite:@"next" priority:LGOperationPriorityDefault key:@"key"];
+    XCTAssertEqualObjects(self.sent, (@[@"lost"]));
+    
+    [self spinRunLoopFor:0.2];
+    XCTAssertEqualObjects(failure.domain, kLGOperationSchedulerErrorDomain);
+    XCTAssertEqual(failure.code, kLGOperationTimeoutErrorCode);
+    XCTAssertEqualObjects(self.sent, (@[@"lost", @"next"]));
+}
+
+- (void)testCompletedOperationDoesNotTimeOut
+{
+    self.scheduler.responseTimeout = 0.05;
+    __block NSError *failure = nil;
+    [self enqueue:@"write" priority:LGOperationPriorityDefault type:LGOperationTypeWrite
+              key:@"key" expectsResponse:YES failure:^(NSError *error) {
+                  failure = error;
+              }];
+    [self.scheduler completeOperationWithType:LGOperationTypeWrite key:@"key"];
+    [self spinRunLoopFor:0.2];
+    XCTAssertNil(failure);
+}
+
+- (void)testOperationsFailWhileDisconnected
+{
+    self.scheduler.connectionReadinessBlock = ^BOOL{
+        return NO;
+    };
+    __block NSError *failure = nil;
+    [self enqueue:@"write" priority:LGOperationPriorityDefault type:LGOperationTypeWrite
+              key:@"key" expectsResponse:YES failure:^(NSError *error) {
+                  failure = error;
+              }];
+    XCTAssertEqual([self.sent count], 0u);
+    XCTAssertEqual(self.scheduler.queueDepth, 0u);
+    XCTAssertEqual(failure.code, kLGOperationNotConnectedErrorCode);
+}
+
+- (void)testCancelFailsWaitingAndInFlightOperations
+{
+    __block NSUInteger failuresCount = 0;
+    LGOperationSchedulerFailureCallback failure = ^(NSError *error) {
+        XCTAssertEqual(error.code, kLGOperationCanceledErrorCode);
+        failuresCount++;
+    };
+    [self enqueue:@"sent" priority:LGOperationPriorityDefault type:LGOperationTypeWrite
+              key:@"key" expectsResponse:YES failure:failure];
+    [self enqueue:@"waiting" priority:LGOperationPriorityDefault type:LGOperationTypeWrite
+              key:@"key" expectsResponse:YES failure:failure];
+    [self.scheduler cancelAllOperations];
+    XCTAssertEqual(failuresCount, 2u);
+    XCTAssertEqual(self.scheduler.inFlightCount, 0u);
+    XCTAssertEqual(self.scheduler.queueDepth, 0u);
+}
+
+@end